@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# renders the shipped scenes and compares them against the golden images committed in scenes/golden with
+# imgcompare; run with --update to render them again, and commit them, only when a change is meant to alter
+# the images
+#
+# raytraced images are deterministic, so they are compared against goldens rendered with the same samples;
+# stochastic ones are compared against goldens with many more samples, within a relmse tolerance about
+# 1.2x their current error and a mean luminance bias tolerance of 2%, so that changes to sampling pass as
+# long as they do not add noise, and brightness shifts fail even when they fit the relmse budget;
+# scene_transforms is not rendered since intersection does not support its animated transforms
+
+update=0
+if [ "$1" == "--update" ]; then update=1; fi
+
+# must cd into scenes folder to handle external data properly
+cd scenes
+mkdir -p golden
+mkdir -p regression
+
+failed=0
+
+# run_test name scene flags resolution samples golden_samples relmse bias
+function run_test {
+    local golden=golden/$1.pfm
+    local image=regression/$1.pfm
+    if [ "$update" -eq "1" ]; then
+        echo "Golden: $1"
+        ../trace -r $4 -s $6 $3 $2 $golden > /dev/null
+        if [ "$?" -ne "0" ]; then echo "An error occurred!"; failed=1; return; fi
+    fi
+    if [ ! -f $golden ]; then echo "$1: missing golden image $golden"; failed=1; return; fi
+    ../trace -r $4 -s $5 $3 $2 $image > /dev/null
+    if [ "$?" -ne "0" ]; then echo "An error occurred!"; failed=1; return; fi
+    ../imgcompare --relmse $7 --bias $8 $golden $image
+    if [ "$?" -ne "0" ]; then failed=1; fi
+}
+
+run_test textures scene_textures.json "" 128 4 4 1e-6 1e-4
+run_test envlight1 scene_envlight1.json "" 128 4 4 1e-6 1e-4
+run_test envlight2 scene_envlight2.json "" 128 4 4 1e-6 1e-4
+run_test envlight3 scene_envlight3.json "" 128 4 4 1e-6 1e-4
+run_test helmet scene_helmet.json "" 128 4 4 1e-6 1e-4
+run_test robot scene_robot.json "" 128 4 4 1e-6 1e-4
+run_test suzanne scene_suzanne.json "" 128 4 4 1e-6 1e-4
+run_test displaced scene_displaced.json "" 128 4 4 1e-6 1e-4
+run_test dist_shadows scene_cornellbox.json "-d" 64 4 16 0.0053 0.02
+run_test dist_reflect scene_blurry.json "-d" 64 4 16 0.00056 0.02
+run_test dist_dof scene_focus.json "-d" 64 4 16 0.0016 0.02
+run_test dist_ao scene_robot.json "-d" 64 4 16 0.008 0.02
+run_test path scene_cornellbox.json "-p" 64 16 256 0.052 0.02
+
+cd ..
+
+if [ "$failed" -ne "0" ]; then
+    echo "Regression failed!"
+    exit 1
+fi
+echo "All regression tests passed!"
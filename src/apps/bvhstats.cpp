@@ -0,0 +1,138 @@
+#include "igl/serialize.h"
+#include "igl/scene.h"
+#include "igl/intersect.h"
+#include "igl/tesselate.h"
+#include "tclap/CmdLine.h"
+
+///@file apps/bvhstats.cpp BVHStats: Reports BVH quality for a scene @ingroup apps
+///@defgroup bvhstats BVHStats: Reports BVH quality for a scene
+///@ingroup apps
+///@{
+
+Scene* scene; ///< scene
+
+bool spatial_splits = false; ///< whether to build shape accelerators with spatial splits
+bool linear_bvh = false; ///< whether to build shape accelerators from Morton codes
+int treelet_passes = 0; ///< treelet restructuring passes for linear shape accelerators
+
+string filename_scene; ///< scene filename
+string filename_stats; ///< output json filename (stdout if empty)
+
+/// parse command line arguments
+void parse_args(int argc, char** argv) {
+	try {
+        TCLAP::CmdLine cmd("bvhstats", ' ', "0.0");
+
+        TCLAP::SwitchArg spatialsplitsArg("S","spatial_splits","Spatial split BVH for all shapes",cmd);
+        TCLAP::SwitchArg linearbvhArg("L","linear_bvh","Linear (Morton code) BVH for all shapes",cmd);
+        TCLAP::ValueArg<int> treeletsArg("","treelets","Treelet restructuring passes for linear BVHs",false,0,"passes",cmd);
+
+        TCLAP::UnlabeledValueArg<string> filenameScene("scene","Scene filename",true,"","filename",cmd);
+        TCLAP::UnlabeledValueArg<string> filenameStats("stats","Output json filename",false,"","filename",cmd);
+
+        cmd.parse( argc, argv );
+
+        if(spatialsplitsArg.isSet()) spatial_splits = spatialsplitsArg.getValue();
+        if(linearbvhArg.isSet()) linear_bvh = linearbvhArg.getValue();
+        if(treeletsArg.isSet()) treelet_passes = treeletsArg.getValue();
+
+        filename_scene = filenameScene.getValue();
+        if(filenameStats.isSet()) filename_stats = filenameStats.getValue();
+	} catch (TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    }
+}
+
+/// accelerator of a shape, following tesselations (nullptr if none)
+BVHAccelerator* shape_accelerator(Shape* shape) {
+    if(shape->_intersect_accelerator) return shape->_intersect_accelerator;
+    if(shape->_tesselation) return shape_accelerator(shape->_tesselation);
+    return nullptr;
+}
+
+/// write a json member value
+template<typename T>
+void write_member(JsonOutputStream& json, const char* name, T value) {
+    json.struct_member_begin(name);
+    json.value(value);
+    json.struct_member_end();
+}
+
+/// write bvh stats as a json object (null if no accelerator)
+void write_stats(JsonOutputStream& json, BVHAccelerator* bvh) {
+    if(not bvh) { json.null(); return; }
+    auto stats = intersect_bvh_stats(bvh);
+    json.struct_begin();
+    write_member(json, "elements", stats.elements);
+    write_member(json, "nodes", stats.nodes);
+    write_member(json, "leaves", stats.leaves);
+    write_member(json, "empty_nodes", stats.empty_nodes);
+    write_member(json, "duplicated_refs", stats.duplicated_refs);
+    write_member(json, "max_depth", stats.max_depth);
+    write_member(json, "sah_cost", stats.sah_cost);
+    write_member(json, "overlap_volume", stats.overlap_volume);
+    write_member(json, "overlap_ratio", stats.overlap_ratio);
+    write_member(json, "bytes", (double)stats.bytes); // double, since out-of-core meshes can exceed int
+    json.struct_member_begin("depth_histogram");
+    json.array(stats.depth_histogram.data(), stats.depth_histogram.size());
+    json.struct_member_end();
+    json.struct_member_begin("leaf_histogram");
+    json.array(stats.leaf_histogram.data(), stats.leaf_histogram.size());
+    json.struct_member_end();
+    json.struct_end();
+}
+
+/// main: load scene, build accelerators, write stats for every shape and the top level group
+int main(int argc, char** argv) {
+    parse_args(argc,argv);
+    Serializer::read_json(scene, filename_scene);
+
+    scene_tesselation_init(scene,false,0,false);
+    for(auto prim : scene->prims->prims) {
+        auto shape = (Shape*)nullptr;
+        if(is<Surface>(prim)) shape = cast<Surface>(prim)->shape;
+        else if(is<TransformedSurface>(prim)) shape = cast<TransformedSurface>(prim)->shape;
+        if(not shape) continue;
+        if(spatial_splits) shape->intersect_accelerator_spatial_splits = true;
+        if(linear_bvh) shape->intersect_accelerator_linear = true;
+        if(treelet_passes) shape->intersect_accelerator_treelet_passes = treelet_passes;
+    }
+    auto t = timer();
+    intersect_scene_accelerate(scene);
+    auto build_time = t.elapsed();
+
+    auto f = (filename_stats.empty()) ? stdout : fopen(filename_stats.c_str(), "wt");
+    ERROR_IF_NOT(f, "cannot open file %s", filename_stats.c_str());
+    auto json = JsonOutputStream(f);
+    json.struct_begin();
+    write_member(json, "scene", filename_scene);
+    write_member(json, "spatial_splits", spatial_splits);
+    write_member(json, "linear", linear_bvh);
+    write_member(json, "treelet_passes", treelet_passes);
+    write_member(json, "build_time", build_time);
+    json.struct_member_begin("top");
+    write_stats(json, scene->prims->_intersect_accelerator);
+    json.struct_member_end();
+    json.struct_member_begin("shapes");
+    json.array_begin();
+    for(auto pid : range(scene->prims->prims.size())) {
+        auto prim = scene->prims->prims[pid];
+        auto shape = (Shape*)nullptr;
+        if(is<Surface>(prim)) shape = cast<Surface>(prim)->shape;
+        else if(is<TransformedSurface>(prim)) shape = cast<TransformedSurface>(prim)->shape;
+        if(not shape) continue;
+        json.struct_begin();
+        write_member(json, "prim", (int)pid);
+        write_member(json, "type", serialize_typename(shape));
+        json.struct_member_begin("stats");
+        write_stats(json, shape_accelerator(shape));
+        json.struct_member_end();
+        json.struct_end();
+    }
+    json.array_end();
+    json.struct_end();
+    fprintf(f, "\n");
+    if(f != stdout) fclose(f);
+}
+
+///@}
@@ -0,0 +1,71 @@
+#include "igl/framebuffer.h"
+#include "tclap/CmdLine.h"
+
+#include <thread>
+
+///@file apps/fbread.cpp FBRead: Reads the shared-memory framebuffer of a running render @ingroup apps
+///@defgroup fbread FBRead: Reads the shared-memory framebuffer of a running render
+///@ingroup apps
+///@{
+
+bool watch = false; ///< whether to follow the render, saving every new frame until it finishes
+float interval = 0.1f; ///< polling interval in seconds when following
+bool remove_finished = false; ///< whether to remove the segment once the finished frame is read
+
+string name; ///< shared memory name
+string filename_image; ///< image filename (png, pfm or ppm; only reports progress if empty)
+
+/// parse command line arguments
+void parse_args(int argc, char** argv) {
+	try {
+        TCLAP::CmdLine cmd("fbread", ' ', "0.0");
+
+        TCLAP::SwitchArg watchArg("w","watch","Follow the render, saving every new frame until it finishes",cmd);
+        TCLAP::ValueArg<float> intervalArg("i","interval","Polling interval in seconds",false,0.1f,"seconds",cmd);
+        TCLAP::SwitchArg removeArg("x","remove","Remove the shared framebuffer once the finished frame is read",cmd);
+
+        TCLAP::UnlabeledValueArg<string> nameArg("name","Shared memory name (e.g. /trace)",true,"","name",cmd);
+        TCLAP::UnlabeledValueArg<string> filenameImage("image","Image filename",false,"","filename",cmd);
+
+        cmd.parse( argc, argv );
+
+        if(watchArg.isSet()) watch = watchArg.getValue();
+        if(intervalArg.isSet()) interval = intervalArg.getValue();
+        if(removeArg.isSet()) remove_finished = removeArg.getValue();
+
+        name = nameArg.getValue();
+        if(filenameImage.isSet()) filename_image = filenameImage.getValue();
+	} catch (TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    }
+}
+
+/// main: map the framebuffer, then save its current frame, or every new one until the render finishes
+/// (renders leave the framebuffer in place when they finish, so it is only removed if asked to)
+int main(int argc, char** argv) {
+    parse_args(argc,argv);
+    auto fb = framebuffer_open(name);
+    ERROR_IF_NOT(fb, "no shared framebuffer %s", name.c_str());
+
+    auto sequence = ~0u;
+    while(true) {
+        auto frame = framebuffer_read(fb);
+        if(frame.sequence != sequence) {
+            sequence = frame.sequence;
+            printf("Pass: %02d/%02d%s\n", frame.passes, frame.passes_total, (frame.finished) ? " finished" : "");
+            fflush(stdout);
+            if(not filename_image.empty()) {
+                image3f img;
+                frame.buffer.get_image(img);
+                imageio_write_auto(filename_image, img, false);
+            }
+        }
+        if(frame.finished and remove_finished) framebuffer_remove(name);
+        if(not watch or frame.finished) break;
+        // wait for the next publish without copying the frame again
+        while(framebuffer_sequence(fb) == sequence) std::this_thread::sleep_for(std::chrono::milliseconds((int)(interval*1000)));
+    }
+    framebuffer_close(fb);
+}
+
+///@}
@@ -0,0 +1,66 @@
+#include "igl/image.h"
+#include "tclap/CmdLine.h"
+
+///@file apps/imgcompare.cpp ImgCompare: Compares renders against a reference image @ingroup apps
+///@defgroup imgcompare ImgCompare: Compares renders against a reference image
+///@ingroup apps
+///@{
+
+float max_rmse = -1; ///< max rmse tolerated (not checked if negative)
+float max_relmse = -1; ///< max relmse tolerated (not checked if negative)
+float min_psnr = -1; ///< min psnr tolerated (not checked if negative)
+float max_bias = -1; ///< max relative mean luminance bias tolerated, either way (not checked if negative)
+
+string filename_reference; ///< reference image filename
+vector<string> filename_images; ///< filenames of the images to compare
+
+/// parse command line arguments
+void parse_args(int argc, char** argv) {
+	try {
+        TCLAP::CmdLine cmd("imgcompare", ' ', "0.0");
+
+        TCLAP::ValueArg<float> rmseArg("","rmse","Max rmse tolerated",false,0,"float",cmd);
+        TCLAP::ValueArg<float> relmseArg("","relmse","Max relmse tolerated",false,0,"float",cmd);
+        TCLAP::ValueArg<float> psnrArg("","psnr","Min psnr tolerated (dB)",false,0,"float",cmd);
+        TCLAP::ValueArg<float> biasArg("","bias","Max relative mean luminance bias tolerated, either way",false,0,"float",cmd);
+
+        TCLAP::UnlabeledValueArg<string> filenameReference("reference","Reference image filename",true,"","filename",cmd);
+        TCLAP::UnlabeledMultiArg<string> filenameImages("images","Image filenames",true,"filename",cmd);
+
+        cmd.parse( argc, argv );
+
+        if(rmseArg.isSet()) max_rmse = rmseArg.getValue();
+        if(relmseArg.isSet()) max_relmse = relmseArg.getValue();
+        if(psnrArg.isSet()) min_psnr = psnrArg.getValue();
+        if(biasArg.isSet()) max_bias = biasArg.getValue();
+
+        filename_reference = filenameReference.getValue();
+        filename_images = filenameImages.getValue();
+	} catch (TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    }
+}
+
+/// main: print the errors of every image against the reference, failing if any is out of tolerance
+int main(int argc, char** argv) {
+    parse_args(argc,argv);
+    auto reference = imageio_read_auto3f(filename_reference, false);
+
+    auto failed = 0;
+    for(auto& filename : filename_images) {
+        auto img = imageio_read_auto3f(filename, false);
+        if(img.width() != reference.width() or img.height() != reference.height()) {
+            printf("%s: size %dx%d, reference %dx%d FAIL\n", filename.c_str(), img.width(), img.height(), reference.width(), reference.height());
+            failed ++;
+            continue;
+        }
+        auto errors = image_errors(reference, img);
+        auto ok = (max_rmse < 0 or errors.rmse <= max_rmse) and (max_relmse < 0 or errors.relmse <= max_relmse) and
+                  (min_psnr < 0 or errors.psnr >= min_psnr) and (max_bias < 0 or fabs(errors.bias) <= max_bias);
+        printf("%s: rmse %g, relmse %g, psnr %.2f dB, bias %+.2f%%%s\n", filename.c_str(), errors.rmse, errors.relmse, errors.psnr, errors.bias*100, (ok) ? "" : " FAIL");
+        if(not ok) failed ++;
+    }
+    return (failed) ? 1 : 0;
+}
+
+///@}
@@ -0,0 +1,110 @@
+#include "igl/serialize.h"
+#include "igl/scene.h"
+#include "igl/intersect.h"
+#include "igl/tesselate.h"
+#include "tclap/CmdLine.h"
+
+///@file apps/raycast.cpp RayCast: Intersects a binary file of rays with a scene @ingroup apps
+///@defgroup raycast RayCast: Intersects a binary file of rays with a scene
+///@ingroup apps
+///@{
+
+Scene* scene; ///< scene
+
+bool any = false; ///< whether to compute any hit instead of the closest hit
+bool spatial_splits = false; ///< whether to build shape accelerators with spatial splits
+bool linear_bvh = false; ///< whether to build shape accelerators from Morton codes
+int treelet_passes = 0; ///< treelet restructuring passes for linear shape accelerators
+
+string filename_scene; ///< scene filename
+string filename_rays; ///< input rays filename: per ray 8 floats (origin, direction, tmin, tmax)
+string filename_hits; ///< output hits filename: per ray float t, int prim, int element, float u, float v (prim -1 if missed); one byte per ray for any hit
+
+/// parse command line arguments
+void parse_args(int argc, char** argv) {
+	try {
+        TCLAP::CmdLine cmd("raycast", ' ', "0.0");
+
+        TCLAP::SwitchArg anyArg("a","any","Any hit instead of closest hit",cmd);
+        TCLAP::SwitchArg spatialsplitsArg("S","spatial_splits","Spatial split BVH for all shapes",cmd);
+        TCLAP::SwitchArg linearbvhArg("L","linear_bvh","Linear (Morton code) BVH for all shapes",cmd);
+        TCLAP::ValueArg<int> treeletsArg("","treelets","Treelet restructuring passes for linear BVHs",false,0,"passes",cmd);
+
+        TCLAP::UnlabeledValueArg<string> filenameScene("scene","Scene filename",true,"","filename",cmd);
+        TCLAP::UnlabeledValueArg<string> filenameRays("rays","Input rays filename",true,"","filename",cmd);
+        TCLAP::UnlabeledValueArg<string> filenameHits("hits","Output hits filename",false,"","filename",cmd);
+
+        cmd.parse( argc, argv );
+
+        if(anyArg.isSet()) any = anyArg.getValue();
+        if(spatialsplitsArg.isSet()) spatial_splits = spatialsplitsArg.getValue();
+        if(linearbvhArg.isSet()) linear_bvh = linearbvhArg.getValue();
+        if(treeletsArg.isSet()) treelet_passes = treeletsArg.getValue();
+
+        filename_scene = filenameScene.getValue();
+        filename_rays = filenameRays.getValue();
+        if(filenameHits.isSet()) filename_hits = filenameHits.getValue();
+	} catch (TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+    }
+}
+
+/// read rays from a binary file
+vector<ray3f> read_rays(const string& filename) {
+    auto f = fopen(filename.c_str(), "rb");
+    ERROR_IF_NOT(f, "cannot open file %s", filename.c_str());
+    auto rays = vector<ray3f>();
+    float buf[8];
+    while(fread(buf, sizeof(float), 8, f) == 8) rays.push_back(ray3f(vec3f(buf[0],buf[1],buf[2]),vec3f(buf[3],buf[4],buf[5]),buf[6],buf[7]));
+    fclose(f);
+    return rays;
+}
+
+/// write hits to a binary file
+void write_hits(const string& filename, const vector<RayHit>& hits) {
+    auto f = fopen(filename.c_str(), "wb");
+    ERROR_IF_NOT(f, "cannot open file %s", filename.c_str());
+    for(auto& hit : hits) {
+        if(any) { unsigned char h = hit.hit; fwrite(&h, 1, 1, f); continue; }
+        fwrite(&hit.t, sizeof(float), 1, f);
+        fwrite(&hit.prim, sizeof(int), 1, f);
+        fwrite(&hit.element, sizeof(int), 1, f);
+        fwrite(&hit.uv, sizeof(float), 2, f);
+    }
+    fclose(f);
+}
+
+/// main: load scene and rays, build accelerators, intersect all rays, write hits and report throughput
+int main(int argc, char** argv) {
+    parse_args(argc,argv);
+    Serializer::read_json(scene, filename_scene);
+    auto rays = read_rays(filename_rays);
+
+    scene_tesselation_init(scene,false,0,false);
+    for(auto prim : scene->prims->prims) {
+        auto shape = (Shape*)nullptr;
+        if(is<Surface>(prim)) shape = cast<Surface>(prim)->shape;
+        else if(is<TransformedSurface>(prim)) shape = cast<TransformedSurface>(prim)->shape;
+        if(not shape) continue;
+        if(spatial_splits) shape->intersect_accelerator_spatial_splits = true;
+        if(linear_bvh) shape->intersect_accelerator_linear = true;
+        if(treelet_passes) shape->intersect_accelerator_treelet_passes = treelet_passes;
+    }
+    auto t = timer();
+    intersect_scene_accelerate(scene);
+    auto build_time = t.elapsed();
+
+    auto hits = vector<RayHit>(rays.size());
+    t = timer();
+    intersect_scene_batch(scene, rays.data(), rays.size(), hits.data(), any);
+    auto cast_time = t.elapsed();
+
+    auto nhits = 0;
+    for(auto& hit : hits) if(hit.hit) nhits ++;
+    printf("Rays: %d, hits: %d, build time: %.3fs, cast time: %.3fs, %.2f Mrays/s on %d threads\n",
+           (int)rays.size(), nhits, build_time, cast_time, rays.size() / max(cast_time,1e-9) / 1e6, parallel_nthreads());
+
+    if(not filename_hits.empty()) write_hits(filename_hits, hits);
+}
+
+///@}
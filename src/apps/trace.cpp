@@ -8,9 +8,21 @@
 #include "igl/distraytrace.h"
 #include "igl/pathtrace.h"
 #include "igl/tesselate.h"
+#include "igl/mapped.h"
+#include "igl/photonmap.h"
+#include "igl/pathguide.h"
+#include "igl/framebuffer.h"
+#include "igl/simplify.h"
 
 #include <thread>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
 ///@file apps/trace.cpp Trace: Raytraces a scene @ingroup apps
 ///@defgroup trace Trace: Raytraces a scene
 ///@ingroup apps
@@ -23,17 +35,45 @@ bool distribution = false; ///< whether to use distribution raytracing
 DistributionRaytraceOptions disttrace_opts; ///< distribution raytracing options
 
 bool pathtrace = false; ///< pathtracing
+bool guiding = false; ///< whether to guide pathtracing with a learned cache
 PathtraceOptions pathtrace_opts; ///< pathtracing options
 
 bool progressive = false; ///< whether to use progressive image savings
 
+bool spatial_splits = false; ///< whether to build shape accelerators with spatial splits
+bool linear_bvh = false; ///< whether to build shape accelerators from Morton codes
+int treelet_passes = 0; ///< treelet restructuring passes for linear shape accelerators
+bool envlight_sh = false; ///< whether to shade envlights from prefiltered irradiance
+bool keep_duplicates = false; ///< whether to keep identical meshes separate instead of sharing them
+DeduplicateStats deduplicate_stats; ///< textures and meshes shared at load time
+bool lod = false; ///< whether to render simplified levels of detail for distant meshes
+LodOptions lod_opts; ///< level of detail options
+
+bool batch = false; ///< whether to render all views of the scene camera path
+string filename_cameras; ///< camera path sidecar filename (implies batch)
+int turntable_views = 0; ///< number of views orbiting the scene camera (implies batch)
+const int batch_tile_size = 32; ///< tile size used to schedule batch rendering
+
+bool server = false; ///< whether to keep the scene resident and serve render jobs from stdin
+string server_socket; ///< if set, serve render jobs on this UNIX socket instead of stdin
+
 ImageBuffer trace_image_buffer; ///< image buffer for progressive rendering
 
+PhotonMap* caustics_raytrace = nullptr; ///< caustic photon map of the raytracer (built when first used)
+PhotonMap* caustics_distribution = nullptr; ///< caustic photon map of the distribution raytracer (built when first used)
+
 string filename_scene; ///< scene filename
-string filename_image; ///< rendered image filename
+string filename_image; ///< rendered image filename (png, pfm or ppm)
+string filename_reference; ///< reference image to report errors against (png or pfm, same size as the render)
+string filename_convergence; ///< error-vs-time curve output (csv), sampled at power-of-two passes (needs a reference)
+string shared_framebuffer; ///< if set, publish the image buffer after every pass in this shared memory segment
 
 int resolution = -1;
 int samples = -1;
+int caustics_photons = -1; ///< caustic photons override (scene settings if negative)
+float caustics_radius = -1; ///< caustic gather radius override (scene settings if not positive)
+bool caustics_stats = false; ///< whether to count and time caustic gathers
+range2i crop = range2i(); ///< crop window override in image pixels (scene settings if not valid)
 
 /// parse command line arguments
 void parse_args(int argc, char** argv) {
@@ -47,6 +87,28 @@ void parse_args(int argc, char** argv) {
         
         TCLAP::SwitchArg distributionArg("d","distribution_raytrace","Distribution Raytracing",cmd);
         TCLAP::SwitchArg pathtraceArg("p","pathtrace","Pathtracing",cmd);
+        TCLAP::SwitchArg guidingArg("G","guiding","Path guiding learned over passes (with pathtracing)",cmd);
+        
+        TCLAP::SwitchArg spatialsplitsArg("S","spatial_splits","Spatial split BVH for all shapes",cmd);
+        TCLAP::SwitchArg linearbvhArg("L","linear_bvh","Linear (Morton code) BVH for all shapes",cmd);
+        TCLAP::ValueArg<int> treeletsArg("","treelets","Treelet restructuring passes for linear BVHs",false,0,"passes",cmd);
+        TCLAP::SwitchArg envlightshArg("E","envlight_sh","Fast diffuse envlights from prefiltered irradiance",cmd);
+        TCLAP::SwitchArg keepduplicatesArg("","keep_duplicates","Keep identical meshes separate instead of sharing them",cmd);
+        TCLAP::ValueArg<float> lodArg("","lod","Simplified meshes for distant surfaces, with this many pixels per triangle in each rendered view",false,1,"pixels",cmd);
+        TCLAP::ValueArg<int> causticsArg("","caustics","Photons emitted for caustics (0: off)",false,0,"int",cmd);
+        TCLAP::ValueArg<float> causticsradiusArg("","caustics_radius","Caustic gather radius",false,0,"float",cmd);
+        TCLAP::SwitchArg causticsstatsArg("","caustics_stats","Count and time caustic gathers",cmd);
+        
+        TCLAP::ValueArg<string> referenceArg("","reference","Reference image to report errors against",false,"","filename",cmd);
+        TCLAP::ValueArg<string> convergenceArg("","convergence","Error-vs-time curve output (csv)",false,"","filename",cmd);
+        TCLAP::ValueArg<string> shmArg("","shm","Publish the image buffer after every pass in this shared memory segment (e.g. /trace), left in place after the render",false,"","name",cmd);
+        TCLAP::ValueArg<string> cropArg("","crop","Render only the pixels in xmin,ymin,xmax,ymax (y down, max excluded)",false,"","xmin,ymin,xmax,ymax",cmd);
+        TCLAP::SwitchArg batchArg("B","batch","Render all views of the scene camera path",cmd);
+        TCLAP::ValueArg<string> camerasArg("","cameras","Render all views of the camera path in this json file",false,"","filename",cmd);
+        TCLAP::ValueArg<int> turntableArg("","turntable","Render this many views orbiting the scene camera",false,0,"int",cmd);
+        
+        TCLAP::SwitchArg serverArg("D","server","Keep the scene loaded and render json jobs read from stdin",cmd);
+        TCLAP::ValueArg<string> socketArg("","socket","Keep the scene loaded and render json jobs read from a UNIX socket",false,"","path",cmd);
         
         TCLAP::UnlabeledValueArg<string> filenameScene("scene","Scene filename",true,"","filename",cmd);
         TCLAP::UnlabeledValueArg<string> filenameImage("image","Image filename",false,"","filename",cmd);
@@ -54,11 +116,38 @@ void parse_args(int argc, char** argv) {
         cmd.parse( argc, argv );
 
         if(pathtraceArg.isSet()) pathtrace = pathtraceArg.getValue();
+        if(guidingArg.isSet()) guiding = guidingArg.getValue();
         if(distributionArg.isSet()) distribution = distributionArg.getValue();
         
         if(resolutionArg.isSet()) resolution = resolutionArg.getValue();
         if(samplesArg.isSet()) samples = samplesArg.getValue();
         if(progressiveArg.isSet()) progressive = progressiveArg.getValue();
+        if(spatialsplitsArg.isSet()) spatial_splits = spatialsplitsArg.getValue();
+        if(linearbvhArg.isSet()) linear_bvh = linearbvhArg.getValue();
+        if(treeletsArg.isSet()) treelet_passes = treeletsArg.getValue();
+        if(envlightshArg.isSet()) envlight_sh = envlightshArg.getValue();
+        if(keepduplicatesArg.isSet()) keep_duplicates = keepduplicatesArg.getValue();
+        if(lodArg.isSet()) {
+            lod = lodArg.getValue() > 0;
+            lod_opts.pixels_per_triangle = lodArg.getValue();
+        }
+        if(causticsArg.isSet()) caustics_photons = causticsArg.getValue();
+        if(causticsradiusArg.isSet()) caustics_radius = causticsradiusArg.getValue();
+        if(causticsstatsArg.isSet()) caustics_stats = causticsstatsArg.getValue();
+        if(cropArg.isSet()) {
+            auto c = range2i();
+            if(sscanf(cropArg.getValue().c_str(), "%d,%d,%d,%d", &c.min.x, &c.min.y, &c.max.x, &c.max.y) != 4 or not isvalid(c))
+                throw TCLAP::ArgException("crop should be xmin,ymin,xmax,ymax", "crop");
+            crop = c;
+        }
+        if(referenceArg.isSet()) filename_reference = referenceArg.getValue();
+        if(convergenceArg.isSet()) filename_convergence = convergenceArg.getValue();
+        if(shmArg.isSet()) shared_framebuffer = shmArg.getValue();
+        if(batchArg.isSet()) batch = batchArg.getValue();
+        if(camerasArg.isSet()) { batch = true; filename_cameras = camerasArg.getValue(); }
+        if(turntableArg.isSet()) { batch = true; turntable_views = turntableArg.getValue(); }
+        if(serverArg.isSet()) server = serverArg.getValue();
+        if(socketArg.isSet()) { server = true; server_socket = socketArg.getValue(); }
         
         filename_scene = filenameScene.getValue();
         if(filenameImage.isSet()) filename_image = filenameImage.getValue();
@@ -78,7 +167,7 @@ void render_pass(image3f& img) {
         dist_raytrace_scene_progressive(trace_image_buffer, scene, disttrace_opts);
 
     }
-    else if(pathtrace) PUT_YOUR_CODE_HERE("Pathtracing");
+    else if(pathtrace) pathtrace_scene_progressive(trace_image_buffer, scene, pathtrace_opts);
     else raytrace_scene_progressive(trace_image_buffer, scene, opts);
 }
 
@@ -92,10 +181,398 @@ void transfer(image3f& img) {
     }
 }
 
-/// main: load scene, initialize acceleration, raytraces scene, saves image
+/// print render time and memory, including how much of the mapped meshes was actually paged in
+void print_memory_stats(float load_time, float render_time) {
+    size_t mapped_size = 0, mapped_resident = 0;
+    for(auto prim : scene->prims->prims) {
+        auto shape = (Shape*)nullptr;
+        if(is<Surface>(prim)) shape = cast<Surface>(prim)->shape;
+        else if(is<TransformedSurface>(prim)) shape = cast<TransformedSurface>(prim)->shape;
+        if(not shape or not is<MappedMesh>(shape)) continue;
+        mapped_size += cast<MappedMesh>(shape)->_mapped_size;
+        mapped_resident += mappedmesh_resident_bytes(cast<MappedMesh>(shape));
+    }
+    printf("Load time: %.3fs, render time: %.3fs\n", load_time, render_time);
+    printf("Peak resident memory: %.1f MB\n", process_resident_bytes_max() / (1024.0*1024.0));
+    if(mapped_size) printf("Mapped meshes resident: %.1f/%.1f MB\n", mapped_resident / (1024.0*1024.0), mapped_size / (1024.0*1024.0));
+    if(deduplicate_stats.shapes or deduplicate_stats.textures)
+        printf("Duplicates shared: %d meshes, %d textures, %.1f MB saved\n", deduplicate_stats.shapes, deduplicate_stats.textures, deduplicate_stats.bytes / (1024.0*1024.0));
+    for(auto prim : scene->prims->prims) {
+        auto shape = (is<Surface>(prim)) ? cast<Surface>(prim)->shape : (is<TransformedSurface>(prim)) ? cast<TransformedSurface>(prim)->shape : nullptr;
+        if(not shape or not is<DisplacedShape>(shape) or not shape->_tesselation) continue;
+        auto displaced = cast<DisplacedShape>(shape);
+        printf("Displaced tesselation level %d: %d vertices, %.2f MB, subdivide %.3fs, displace %.3fs, frames %.3fs\n",
+               displaced->level, (int)shape_get_pos(shape->_tesselation)->size(), tesselation_bytes(shape->_tesselation) / (1024.0*1024.0),
+               displaced->_subdivide_time, displaced->_displace_time, displaced->_frames_time);
+    }
+    if(scene->_caustics) photonmap_print_stats(scene->_caustics);
+    if(pathtrace_opts._guide) pathguide_print_stats(pathtrace_opts._guide);
+}
+
+/// image resolution of the active renderer
+int renderer_res() { return (distribution) ? disttrace_opts.res : (pathtrace) ? pathtrace_opts.res : opts.res; }
+
+/// whether the active renderer lights the scene from the camera
+bool renderer_cameralights() { return (distribution) ? disttrace_opts.cameralights : (pathtrace) ? pathtrace_opts.cameralights : opts.cameralights; }
+
+/// places the camera lights for the scene camera, with the directions and colors of the active renderer, if it uses them
+void renderer_cameralights_update() {
+    if(not renderer_cameralights()) return;
+    if(distribution) scene_cameralights_update(scene, disttrace_opts.cameralights_dir, disttrace_opts.cameralights_col);
+    else if(pathtrace) scene_cameralights_update(scene, pathtrace_opts.cameralights_dir, pathtrace_opts.cameralights_col);
+    else scene_cameralights_update(scene, opts.cameralights_dir, opts.cameralights_col);
+}
+
+/// render the scene with the current options and save it; with a reference image, report the errors of the
+/// render and optionally record them after 1, 2, 4, ... passes against the render time so far
+void render_image(const string& filename, bool verbose) {
+    auto w = camera_image_width(scene->camera, opts.res);
+    auto h = camera_image_height(scene->camera, opts.res);
+    image<vec3f> img;
+    init_buffers(w, h);
+    auto samples = (pathtrace ? pathtrace_opts.samples : (distribution ? disttrace_opts.samples : opts.samples ) );
+
+    auto reference = image3f();
+    if(not filename_reference.empty()) {
+        reference = imageio_read_auto3f(filename_reference, false);
+        ERROR_IF_NOT(reference.width() == w and reference.height() == h, "reference image should be %dx%d", w, h);
+    }
+    auto curve = (FILE*)nullptr;
+    if(not filename_convergence.empty()) {
+        ERROR_IF_NOT(not filename_reference.empty(), "convergence curves need a reference image");
+        curve = fopen(filename_convergence.c_str(), "wt");
+        ERROR_IF_NOT(curve, "cannot open file %s", filename_convergence.c_str());
+        fprintf(curve, "passes,time,rmse,relmse,psnr\n");
+    }
+    
+    auto fb = (shared_framebuffer.empty()) ? nullptr : framebuffer_create(shared_framebuffer, w, h, samples);
+    
+    // time spent on snapshots is not counted as render time
+    auto render_time = 0.0;
+    for(auto s = 0; s < samples; s ++) {
+        if(verbose) printf("Pass: %02d/%02d\n", s, samples);
+        auto pass_timer = timer();
+        render_pass(img);
+        render_time += pass_timer.elapsed();
+        if(fb) framebuffer_publish(fb, trace_image_buffer, s+1, s == samples-1);
+        if(progressive && s < samples-1) {
+            trace_image_buffer.get_image(img);
+            imageio_write_auto(filename, img, false);
+        }
+        if(curve and (((s+1) & s) == 0 or s == samples-1)) {
+            trace_image_buffer.get_image(img);
+            auto errors = image_errors(reference, img);
+            fprintf(curve, "%d,%g,%g,%g,%g\n", s+1, render_time, errors.rmse, errors.relmse, errors.psnr);
+            fflush(curve);
+        }
+    }
+    trace_image_buffer.get_image(img);
+    imageio_write_auto(filename, img, false);
+    if(curve) fclose(curve);
+    if(fb) framebuffer_close(fb);
+    if(not filename_reference.empty()) {
+        auto errors = image_errors(reference, img);
+        printf("Errors: rmse %g, relmse %g, psnr %.2f dB\n", errors.rmse, errors.relmse, errors.psnr);
+    }
+}
+
+/// whether images can be saved to filename (png, pfm or ppm)
+bool image_filename_supported(const string& filename) {
+    return string_endswith(filename, "png") or string_endswith(filename, "pfm") or string_endswith(filename, "ppm");
+}
+
+/// image filename for a view of a batch, numbered before the extension: image_<view>.png (or .pfm, .ppm)
+string batch_image_filename(const string& filename, int view) {
+    auto dot = filename.rfind('.'), slash = filename.rfind('/');
+    if(dot == string::npos or (slash != string::npos and dot < slash)) dot = filename.length();
+    return filename.substr(0,dot) + to_string("_%03d", view) + filename.substr(dot);
+}
+
+/// render every view, scheduling the tiles of all views across threads so that cores stay busy across views,
+/// then save them with batch_image_filename; camera lights and levels of detail follow the camera, so with them
+/// views are rendered one at a time, with their tiles still in parallel
+void render_batch(const vector<Camera*>& cameras, const string& filename) {
+    // makes camera the scene camera, placing its camera lights and selecting its levels of detail
+    auto view_setup = [](Camera* camera) {
+        scene->camera = camera;
+        renderer_cameralights_update();
+        if(lod and scene_lods_select(scene, camera, renderer_res(), lod_opts)) intersect_scene_reaccelerate(scene);
+    };
+    
+    // the pathtracer renders whole images from the scene camera, so views go one at a time, sharing the guiding cache
+    if(pathtrace) {
+        auto saved_camera = scene->camera;
+        for(auto view : range(cameras.size())) {
+            view_setup(cameras[view]);
+            auto buffer = ImageBuffer(camera_image_width(cameras[view], pathtrace_opts.res), camera_image_height(cameras[view], pathtrace_opts.res));
+            for(auto s = 0; s < pathtrace_opts.samples; s ++) pathtrace_scene_progressive(buffer, scene, pathtrace_opts);
+            image<vec3f> img;
+            buffer.get_image(img);
+            imageio_write_auto(batch_image_filename(filename, view), img, false);
+        }
+        view_setup(saved_camera);
+        return;
+    }
+    
+    auto buffers = vector<ImageBuffer>();
+    for(auto camera : cameras) buffers.push_back(ImageBuffer(camera_image_width(camera, opts.res), camera_image_height(camera, opts.res)));
+    auto samples = (distribution ? disttrace_opts.samples : opts.samples);
+    
+    // the distribution raytracer advances the rng in its options, so every thread gets its own
+    auto thread_disttrace_opts = vector<DistributionRaytraceOptions>(parallel_nthreads(), disttrace_opts);
+    for(auto t : range(thread_disttrace_opts.size())) thread_disttrace_opts[t].rng.seed(t+1);
+    
+    auto render_tiles = [&](const vector<pair<int,range2i>>& tiles) {
+        parallel_for_dynamic(tiles.size(), [&](int tid, int thread) {
+            auto view = tiles[tid].first;
+            for(auto s = 0; s < samples; s ++) {
+                if(distribution) dist_raytrace_scene_tile(buffers[view], scene, cameras[view], tiles[tid].second, thread_disttrace_opts[thread]);
+                else raytrace_scene_tile(buffers[view], scene, cameras[view], tiles[tid].second, opts);
+            }
+        });
+    };
+    auto view_tiles = [&](int view, vector<pair<int,range2i>>& tiles) {
+        auto crop_tile = image_crop_tile((distribution) ? disttrace_opts.crop : opts.crop, buffers[view].width(), buffers[view].height());
+        for(int j = 0; j < buffers[view].height(); j += batch_tile_size) {
+            for(int i = 0; i < buffers[view].width(); i += batch_tile_size) {
+                auto tile_max = vec2i(min(i+batch_tile_size,buffers[view].width()), min(j+batch_tile_size,buffers[view].height()));
+                auto tile = rintersect(range2i(vec2i(i,j), tile_max), crop_tile);
+                if(isvalid(tile)) tiles.push_back({view, tile});
+            }
+        }
+    };
+    
+    auto saved_camera = scene->camera;
+    if(renderer_cameralights() or lod) {
+        for(auto view : range(cameras.size())) {
+            view_setup(cameras[view]);
+            auto tiles = vector<pair<int,range2i>>();
+            view_tiles(view, tiles);
+            render_tiles(tiles);
+        }
+        view_setup(saved_camera);
+    } else {
+        auto tiles = vector<pair<int,range2i>>();
+        for(auto view : range(cameras.size())) view_tiles(view, tiles);
+        render_tiles(tiles);
+    }
+    
+    for(auto view : range(cameras.size())) {
+        image<vec3f> img;
+        buffers[view].get_image(img);
+        imageio_write_auto(batch_image_filename(filename, view), img, false);
+    }
+}
+
+/// render job for server mode, read as a json object on a single line, e.g.
+/// { "image": "out.png", "res": 256, "samples": 4, "renderer": "distribution", "camera": { "_type": "Camera", ... } }
+struct RenderJob {
+    string      image; ///< rendered image filename
+    int         res = -1; ///< image resolution (scene settings if not positive)
+    int         samples = -1; ///< pixel samples (scene settings if not positive)
+    string      renderer; ///< "raytrace", "distribution" or "pathtrace" (command line choice if empty)
+    Camera*     camera = nullptr; ///< camera override (scene camera if null)
+    bool        quit = false; ///< stop serving
+    string      error; ///< why the job could not be read (not rendered if set)
+};
+
+/// json string literal for replies, escaping client text
+string json_string(const string& value) {
+    auto ret = string("\"");
+    for(auto c : value) {
+        if(c == '"' or c == '\\') { ret += '\\'; ret += c; }
+        else if(c == '\n') ret += "\\n";
+        else if(c == '\r') ret += "\\r";
+        else if(c == '\t') ret += "\\t";
+        else if((unsigned char)c < 0x20) { char buf[8]; sprintf(buf, "\\u%04x", c); ret += buf; }
+        else ret += c;
+    }
+    return ret + "\"";
+}
+
+/// parse a render job from a json line; malformed jobs set job.error instead of stopping the server
+RenderJob parse_job(const string& line) {
+    auto job = RenderJob();
+    // the serializer stops on unknown types and missing files, so only inline cameras are accepted
+    JsonInputStream peek(line, true);
+    peek.struct_begin();
+    if(peek.struct_member_begin("camera") and not peek.null()) {
+        auto type = string();
+        peek.struct_begin();
+        if(peek.struct_member_begin("_type")) peek.value(type);
+        if(peek.error.empty() and (type != "Camera" or peek.struct_has_member("_include") or peek.struct_has_member("_ref")))
+            job.error = "camera should be an inline Camera";
+    }
+    if(not peek.error.empty()) job.error = peek.error;
+    if(not job.error.empty()) return job;
+    
+    JsonInputStream stream(line, true);
+    auto ser = Serializer(&stream,false);
+    stream.struct_begin();
+    ser.serialize_member("image",job.image);
+    ser.serialize_member("res",job.res);
+    ser.serialize_member("samples",job.samples);
+    ser.serialize_member("renderer",job.renderer);
+    ser.serialize_member("camera",job.camera);
+    ser.serialize_member("quit",job.quit);
+    stream.struct_end();
+    if(not stream.error.empty()) {
+        job.error = stream.error;
+        if(job.camera) { delete job.camera; job.camera = nullptr; }
+    }
+    return job;
+}
+
+/// sets up the active renderer for the scene camera and its resolution, at startup and for every job: places
+/// its camera lights, selects levels of detail (accelerating the shapes newly used), and builds the caustic photon map of the renderer the
+/// first time it is used, since the map only depends on the scene and is shared by all views and jobs
+void renderer_setup() {
+    renderer_cameralights_update();
+    if(lod and scene_lods_select(scene, scene->camera, renderer_res(), lod_opts)) intersect_scene_reaccelerate(scene);
+    if(distribution) {
+        if(not caustics_distribution and disttrace_opts.caustics_photons > 0) {
+            caustics_distribution = photonmap_caustics_build(scene, disttrace_opts.caustics_photons, disttrace_opts.caustics_radius,
+                                                             disttrace_opts.caustics_nearest, disttrace_opts.max_depth, disttrace_opts.doublesided);
+            caustics_distribution->stats = caustics_stats;
+        }
+        scene->_caustics = caustics_distribution;
+    }
+    else if(not pathtrace) {
+        if(not caustics_raytrace and opts.caustics_photons > 0) {
+            caustics_raytrace = photonmap_caustics_build(scene, opts.caustics_photons, opts.caustics_radius,
+                                                         opts.caustics_nearest, opts.max_depth, opts.doublesided);
+            caustics_raytrace->stats = caustics_stats;
+        }
+        scene->_caustics = caustics_raytrace;
+    }
+    else scene->_caustics = nullptr;
+}
+
+/// frees the caustic photon maps built by renderer_setup and the guiding cache
+void renderer_cleanup() {
+    if(pathtrace_opts._guide) { pathguide_free(pathtrace_opts._guide); pathtrace_opts._guide = nullptr; }
+    scene->_caustics = nullptr;
+    delete caustics_raytrace; caustics_raytrace = nullptr;
+    delete caustics_distribution; caustics_distribution = nullptr;
+}
+
+/// render a job with the resident scene and accelerators, restoring the server settings afterwards
+void render_job(RenderJob& job) {
+    auto saved_opts = opts;
+    auto saved_disttrace_opts = disttrace_opts;
+    auto saved_pathtrace_opts = pathtrace_opts;
+    auto saved_distribution = distribution, saved_pathtrace = pathtrace;
+    auto saved_camera = scene->camera;
+    auto saved_filename_reference = filename_reference, saved_filename_convergence = filename_convergence;
+    
+    // the reference only matches the startup image size, and its errors would go to stdout, which carries the replies
+    filename_reference = "";
+    filename_convergence = "";
+    if(job.res > 0) {
+        opts.res = job.res;
+        disttrace_opts.res = job.res;
+        pathtrace_opts.res = job.res;
+    }
+    if(job.samples > 0) {
+        opts.samples = job.samples;
+        disttrace_opts.samples = job.samples;
+        pathtrace_opts.samples = job.samples;
+    }
+    if(not job.renderer.empty()) {
+        distribution = job.renderer == "distribution";
+        pathtrace = job.renderer == "pathtrace";
+    }
+    if(job.camera) scene->camera = job.camera;
+    renderer_setup();
+    
+    render_image(job.image, false);
+    
+    // the guiding cache only depends on the scene, so it stays resident and keeps learning across jobs
+    auto guide = pathtrace_opts._guide;
+    opts = saved_opts;
+    disttrace_opts = saved_disttrace_opts;
+    pathtrace_opts = saved_pathtrace_opts;
+    pathtrace_opts._guide = guide;
+    distribution = saved_distribution; pathtrace = saved_pathtrace;
+    filename_reference = saved_filename_reference;
+    filename_convergence = saved_filename_convergence;
+    if(job.camera) {
+        scene->camera = saved_camera;
+        delete job.camera; job.camera = nullptr;
+    }
+    renderer_cameralights_update();
+}
+
+/// serve render jobs, one json object per line, replying with one json line per job
+/// (latency counts from reading the job to writing its image); returns whether a job asked to quit
+bool serve_jobs(FILE* in, FILE* out) {
+    auto quit = false;
+    char* buf = nullptr; size_t buf_size = 0;
+    while(not quit and getline(&buf, &buf_size, in) >= 0) {
+        auto latency_timer = timer();
+        auto line = string(buf);
+        while(not line.empty() and isspace(line.back())) line.pop_back();
+        if(line.empty()) continue;
+        auto job = parse_job(line);
+        if(not job.error.empty()) { fprintf(out, "{ \"error\": %s }\n", json_string(job.error).c_str()); fflush(out); continue; }
+        if(job.quit) { quit = true; continue; }
+        if(job.image.empty()) { fprintf(out, "{ \"error\": \"missing image\" }\n"); fflush(out); continue; }
+        if(not image_filename_supported(job.image)) {
+            fprintf(out, "{ \"image\": %s, \"error\": \"image extension not supported\" }\n", json_string(job.image).c_str()); fflush(out);
+            if(job.camera) delete job.camera;
+            continue;
+        }
+        if(not job.renderer.empty() and job.renderer != "raytrace" and job.renderer != "distribution" and job.renderer != "pathtrace") {
+            fprintf(out, "{ \"image\": %s, \"error\": %s }\n", json_string(job.image).c_str(), json_string("unknown renderer "+job.renderer).c_str()); fflush(out);
+            if(job.camera) delete job.camera;
+            continue;
+        }
+        auto render_timer = timer();
+        render_job(job);
+        auto render_time = render_timer.elapsed();
+        fprintf(out, "{ \"image\": %s, \"render_time\": %f, \"latency\": %f }\n", json_string(job.image).c_str(), render_time, latency_timer.elapsed());
+        fflush(out);
+    }
+    free(buf);
+    return quit;
+}
+
+/// serve render jobs to clients of a local UNIX socket, one client at a time, until a job asks to quit
+void serve_socket(const string& path) {
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+    auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ERROR_IF_NOT(fd >= 0, "cannot create socket");
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ERROR_IF_NOT(path.length() < sizeof(addr.sun_path), "socket path too long %s", path.c_str());
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+    unlink(path.c_str());
+    ERROR_IF_NOT(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0, "cannot bind socket %s", path.c_str());
+    ERROR_IF_NOT(listen(fd, 8) == 0, "cannot listen on socket %s", path.c_str());
+    auto quit = false;
+    while(not quit) {
+        auto client = accept(fd, nullptr, nullptr);
+        if(client < 0) continue;
+        auto in = fdopen(client, "r");
+        auto out = fdopen(dup(client), "w");
+        quit = serve_jobs(in, out);
+        fclose(in);
+        fclose(out);
+    }
+    close(fd);
+    unlink(path.c_str());
+#else
+    NOT_IMPLEMENTED_ERROR();
+#endif
+}
+
+/// main: load scene, initialize acceleration, raytraces scene, saves image (or serves render jobs)
 int main(int argc, char** argv) {
     parse_args(argc,argv);
-    Serializer::read_json(scene, filename_scene);
+    auto load_timer = timer();
+    Serializer::read_json(scene, filename_scene, &deduplicate_stats);
     if(scene->raytrace_opts) opts = *scene->raytrace_opts;
     if(scene->distribution_opts) disttrace_opts = *scene->distribution_opts;
     if(scene->pathtrace_opts) pathtrace_opts = *scene->pathtrace_opts;
@@ -111,30 +588,103 @@ int main(int argc, char** argv) {
         disttrace_opts.samples = samples;
         pathtrace_opts.samples = samples;
     }
+    if(envlight_sh) {
+        opts.envlight_sh = true;
+        disttrace_opts.envlight_sh = true;
+    }
+    if(guiding) pathtrace_opts.guiding = true;
+    if(isvalid(crop)) {
+        opts.crop = crop;
+        disttrace_opts.crop = crop;
+        pathtrace_opts.crop = crop;
+    }
+    if(caustics_photons >= 0) {
+        opts.caustics_photons = caustics_photons;
+        disttrace_opts.caustics_photons = caustics_photons;
+    }
+    if(caustics_radius > 0) {
+        opts.caustics_radius = caustics_radius;
+        disttrace_opts.caustics_radius = caustics_radius;
+    }
 
+    if(not keep_duplicates) {
+        auto merged = scene_deduplicate(scene);
+        deduplicate_stats.shapes += merged.shapes;
+        deduplicate_stats.textures += merged.textures;
+        deduplicate_stats.bytes += merged.bytes;
+    }
     scene_tesselation_init(scene,false,0,false);
     //scene_animation_snapshot(scene,opts.time);
-    sample_lights_init(scene->lights);
-    if(opts.cameralights) scene_cameralights_update(scene,opts.cameralights_dir, opts.cameralights_col);
+    sample_lights_init(scene->lights, opts.envlight_sh or disttrace_opts.envlight_sh);
+    for(auto prim : scene->prims->prims) {
+        auto shape = (Shape*)nullptr;
+        if(is<Surface>(prim)) shape = cast<Surface>(prim)->shape;
+        else if(is<TransformedSurface>(prim)) shape = cast<TransformedSurface>(prim)->shape;
+        if(not shape) continue;
+        if(spatial_splits) shape->intersect_accelerator_spatial_splits = true;
+        if(linear_bvh) shape->intersect_accelerator_linear = true;
+        if(treelet_passes) shape->intersect_accelerator_treelet_passes = treelet_passes;
+    }
+    if(lod) {
+        // levels copy the accelerator settings of their shapes, so they are built after the overrides above
+        auto lod_timer = timer();
+        scene_lods_init(scene, lod_opts);
+        scene_lods_select(scene, scene->camera, renderer_res(), lod_opts);
+        auto triangles = 0l, triangles_rendered = 0l;
+        for(auto prim : scene->prims->prims) {
+            if(is<Surface>(prim)) {
+                triangles += lod_triangles(cast<Surface>(prim)->shape);
+                triangles_rendered += lod_triangles(surface_rendered_shape(cast<Surface>(prim)));
+            }
+            else if(is<TransformedSurface>(prim)) {
+                triangles += lod_triangles(cast<TransformedSurface>(prim)->shape);
+                triangles_rendered += lod_triangles(transformed_rendered_shape(cast<TransformedSurface>(prim)));
+            }
+        }
+        // stdout carries the replies when serving stdin
+        fprintf((server) ? stderr : stdout, "Levels of detail: %ld/%ld triangles rendered, built in %.3fs\n", triangles_rendered, triangles, lod_timer.elapsed());
+    }
     intersect_scene_accelerate(scene);
+    auto load_time = load_timer.elapsed();
     
-    auto w = camera_image_width(scene->camera, opts.res);
-    auto h = camera_image_height(scene->camera, opts.res);
-    image<vec3f> img;
-    init_buffers(w, h);
-    auto samples = (pathtrace ? pathtrace_opts.samples : (distribution ? disttrace_opts.samples : opts.samples ) );
-
-    // for debug:
-    for(auto s = 0; s < samples; s ++) {
-        printf("Pass: %02d/%02d\n", s, samples);
-        render_pass(img);
-        if(progressive && s < samples-1) {
-            trace_image_buffer.get_image(img);
-            imageio_write_png(filename_image, img, false);
+    renderer_setup();
+    
+    if(server) {
+        // stdout carries the replies when serving stdin, so log to stderr
+        fprintf(stderr, "Load time: %.3fs, serving jobs on %s\n", load_time, (server_socket.empty()) ? "stdin" : server_socket.c_str());
+        if(server_socket.empty()) serve_jobs(stdin, stdout);
+        else serve_socket(server_socket);
+        renderer_cleanup();
+        return 0;
+    }
+    
+    if(batch) {
+        auto path = scene->camera_path;
+        if(not filename_cameras.empty()) Serializer::read_json(path, filename_cameras);
+        if(turntable_views > 0) {
+            path = new CameraPath();
+            path->cameras.push_back(scene->camera);
+            path->views = turntable_views;
+            path->turntable = true;
         }
+        ERROR_IF_NOT(path, "no camera path for batch rendering");
+        ERROR_IF_NOT(image_filename_supported(filename_image), "image extension not supported");
+        auto cameras = camera_path_views(path);
+        auto render_timer = timer();
+        render_batch(cameras, filename_image);
+        auto render_time = render_timer.elapsed();
+        printf("Rendered %d views, %.3fs per view\n", (int)cameras.size(), render_time / max((int)cameras.size(),1));
+        print_memory_stats(load_time, render_time);
+        for(auto camera : cameras) delete camera;
+        renderer_cleanup();
+        return 0;
     }
-    trace_image_buffer.get_image(img);
-    imageio_write_png(filename_image, img, false);
+    
+    auto render_timer = timer();
+    render_image(filename_image, true);
+    auto render_time = render_timer.elapsed();
+    print_memory_stats(load_time, render_time);
+    renderer_cleanup();
 }
 
 ///@}
@@ -9,6 +9,7 @@
 #include "igl/draw.h"
 #include "igl/intersect.h"
 #include "igl/tesselate.h"
+#include "igl/simplify.h"
 
 #include "igl/distraytrace.h"
 #include "igl/raytrace.h"
@@ -39,6 +40,9 @@ string              filename_image = ""; ///< captured image filename
 int                 tesselation_level = -1; ///< tesselation override level (-1 for default)
 bool                tesselation_smooth = false; ///< tesselation override smooth
 
+bool                lod = false; ///< whether to draw simplified levels of detail for distant meshes
+LodOptions          lod_opts; ///< level of detail options
+
 bool                hud = true; ///< whether to display the hud
 timer_avg           hud_fps_update; ///< whether to display update frames-per-second in the hud
 timer_avg           hud_fps_display; ///< whether to display draw frames-per-second in the hud
@@ -70,6 +74,15 @@ bool                trace_progressive_clear = false; ///< progressive tracing, w
 image3f             trace_img; ///< traced image
 ImageBuffer         trace_image_buffer; ///< progressive buffer
 
+bool                trace_camera_moved = false; ///< only the camera moved, reproject the accumulation instead of restarting
+Camera              trace_camera; ///< camera the accumulation was traced from
+image3f             trace_positions; ///< world position seen through each pixel center of the accumulation
+image3f             trace_normals; ///< surface normal at trace_positions
+image<float>        trace_depths; ///< distance to trace_positions along the pixel rays (0 where the background is seen)
+float               trace_reproject_tolerance = 2; ///< reprojected points farther than this many pixel footprints from the previous surface are disoccluded
+range2i             trace_crop_selecting = range2i(); ///< crop window being dragged in trace image pixels (not valid if none)
+float               trace_reproject_normal_cos = 0.9f; ///< reprojected points whose normal differs more than this from the previous one are disoccluded
+
 /// init trace progressive buffers
 void trace_clear_buffers() {
     auto wc = camera_image_width(scene->camera, trace_opts.res);
@@ -105,6 +118,68 @@ void trace_sync_opts() {
     //trace_path_opts.ambient = draw_opts.ambient;
 }
 
+/// computes the world positions (directions for the background), normals and depths seen through the trace pixel centers
+void trace_gbuffer_update(Camera* camera, image3f& positions, image3f& normals, image<float>& depths) {
+    auto w = trace_image_buffer.width();
+    auto h = trace_image_buffer.height();
+    positions = image3f(w,h);
+    normals = image3f(w,h);
+    depths = image<float>(w,h);
+    parallel_for(h, [&](int start, int end) {
+        for(int j = start; j < end; j ++) {
+            for(int i = 0; i < w; i ++) {
+                auto ray = camera_ray(camera, vec2f((i+0.5f)/w,(j+0.5f)/h));
+                intersection3f intersection;
+                auto hit = intersect_scene_first(scene,ray,intersection);
+                positions.at(i,h-1-j) = (hit) ? intersection.frame.o : ray.d;
+                normals.at(i,h-1-j) = (hit) ? intersection.frame.z : zero3f;
+                depths.at(i,h-1-j) = (hit) ? dist(ray.e,intersection.frame.o) : 0;
+            }
+        }
+    });
+}
+
+/// warps the accumulation into the current camera: each pixel takes the history of the pixel that saw the same
+/// point from the previous camera (the same direction for the background), and starts from scratch where that
+/// pixel saw another surface, i.e. the point was hidden, or was off screen (disocclusion); surfaces are compared
+/// by distance from the previous tangent plane, which unlike the distance between points holds at grazing angles
+void trace_reproject() {
+    auto w = trace_image_buffer.width();
+    auto h = trace_image_buffer.height();
+    auto positions = image3f();
+    auto normals = image3f();
+    auto depths = image<float>();
+    trace_gbuffer_update(scene->camera, positions, normals, depths);
+    auto footprint = trace_reproject_tolerance * scene->camera->image_height / (h * scene->camera->image_dist);
+    auto buffer = ImageBuffer(w,h);
+    parallel_for(h, [&](int start, int end) {
+        for(int y = start; y < end; y ++) {
+            for(int x = 0; x < w; x ++) {
+                auto depth = depths.at(x,y);
+                auto pos = positions.at(x,y);
+                auto uv = zero2f;
+                if(not camera_project(&trace_camera, (depth > 0) ? pos : trace_camera.frame.o + pos, uv)) continue;
+                auto px = clamp((int)(uv.x*w),0,w-1), py = clamp(h-1-(int)(uv.y*h),0,h-1);
+                auto prev_depth = trace_depths.at(px,py);
+                if((depth > 0) != (prev_depth > 0)) continue;
+                if(depth > 0) {
+                    auto tolerance = footprint * ((scene->camera->orthographic) ? scene->camera->image_dist : max(depth,prev_depth));
+                    auto prev_normal = trace_normals.at(px,py);
+                    if(abs(dot(pos-trace_positions.at(px,py),prev_normal)) > tolerance) continue;
+                    if(abs(dot(normals.at(x,y),prev_normal)) < trace_reproject_normal_cos) continue;
+                }
+                buffer.accum.at(x,y) = trace_image_buffer.accum.at(px,py);
+                buffer.samples.at(x,y) = trace_image_buffer.samples.at(px,py);
+            }
+        }
+    });
+    trace_image_buffer = buffer;
+    trace_positions = positions;
+    trace_normals = normals;
+    trace_depths = depths;
+    trace_camera = *scene->camera;
+}
+
 /// performs one pass of progressive tracing
 void trace_progressive_pass() {
     if(not trace) return;
@@ -119,7 +194,7 @@ void trace_progressive_pass() {
                                         trace_distributed_opts);
 
     }
-    else if(trace_path) PUT_YOUR_CODE_HERE("Pathtracing");
+    else if(trace_path) pathtrace_scene_progressive(trace_image_buffer, scene, trace_path_opts);
     else raytrace_scene_progressive(trace_image_buffer, scene, trace_opts);
     
     trace_image_buffer.get_image(trace_img);
@@ -129,10 +204,51 @@ void trace_progressive_pass() {
 void trace_progressive_start() {
     if(trace_progressive_clear) trace_img.set(trace_opts.background);
     trace_clear_buffers();
+    trace_camera = *scene->camera;
+    trace_gbuffer_update(&trace_camera, trace_positions, trace_normals, trace_depths);
+    trace_progressive_cursample = 0;
+    trace_progressive_maxsamples = (trace_path) ? trace_path_opts.samples : (trace_distributed ? trace_distributed_opts.samples : trace_opts.samples );
+}
+
+/// restarts progressive tracing after a camera motion, continuing from the reprojected accumulation; camera lights
+/// move with the camera and change the shading, so with them tracing starts from scratch
+void trace_progressive_reproject() {
+    auto cameralights = (trace_path) ? trace_path_opts.cameralights : (trace_distributed ? trace_distributed_opts.cameralights : trace_opts.cameralights);
+    if(cameralights) { trace_progressive_start(); return; }
+    trace_reproject();
+    trace_image_buffer.get_image(trace_img);
+    trace_progressive_cursample = 0;
+    trace_progressive_maxsamples = (trace_path) ? trace_path_opts.samples : (trace_distributed ? trace_distributed_opts.samples : trace_opts.samples );
+}
+
+/// sets the crop window of all tracers (clears it if not valid) and restarts tracing inside it only, keeping what
+/// was traced outside it for context
+void trace_crop_update(const range2i& crop) {
+    trace_opts.crop = crop;
+    trace_distributed_opts.crop = crop;
+    trace_path_opts.crop = crop;
+    if(not isvalid(crop)) { trace_updated = true; return; }
+    auto w = trace_image_buffer.width();
+    auto h = trace_image_buffer.height();
+    auto tile = image_crop_tile(crop, w, h);
+    for(int j = tile.min.y; j < tile.max.y; j ++) {
+        for(int i = tile.min.x; i < tile.max.x; i ++) {
+            trace_image_buffer.accum.at(i,h-1-j) = zero3f;
+            trace_image_buffer.samples.at(i,h-1-j) = 0;
+        }
+    }
     trace_progressive_cursample = 0;
     trace_progressive_maxsamples = (trace_path) ? trace_path_opts.samples : (trace_distributed ? trace_distributed_opts.samples : trace_opts.samples );
 }
 
+/// trace image pixel under the window position x,y (in the trace pane on the right)
+vec2i trace_pixel(int x, int y) {
+    int w = glutGet(GLUT_WINDOW_WIDTH) / 2;
+    int h = glutGet(GLUT_WINDOW_HEIGHT);
+    auto zoom = min(float(w) / trace_img.width(), float(h) / trace_img.height());
+    return vec2i(clamp((int)((x-w)/zoom),0,trace_img.width()), clamp((int)(y/zoom),0,trace_img.height()));
+}
+
 /// trace the whole image
 void trace_render() {
     trace_clear_buffers();
@@ -269,13 +385,17 @@ void init() {
     if(scene->pathtrace_opts) trace_path_opts = *scene->pathtrace_opts;
 
     selection_element_clear();
+    if(lod) {
+        scene_lods_init(scene, lod_opts);
+        scene_lods_select(scene, scene->camera, draw_opts.res, lod_opts);
+    }
     if(trace) {
         trace_init_res();
         //if(accelerate_scene) {
             scene->prims->intersect_accelerator_use = false;
             intersect_scene_accelerate(scene);
         //}
-        sample_lights_init(scene->lights);
+        sample_lights_init(scene->lights, trace_opts.envlight_sh or trace_distributed_opts.envlight_sh);
     }
     trace_updated = true;
 }
@@ -371,6 +491,8 @@ void print_help() {
            ";/'                 trace resolution\n"
            ":/\"                trace samples\n"
            "P                   trace clear background\n"
+           "shift-mouse-left    trace crop window (drag on the trace image)\n"
+           "c                   trace crop window clear\n"
            "\n");
 }
 
@@ -423,6 +545,7 @@ void keyboard(unsigned char c, int x, int y) {
         case ':': trace_samples_update(-1); break;
         case '"': trace_samples_update(+1); break;
         case 'P': trace_progressive_clear = not trace_progressive_clear; break;
+        case 'c': trace_crop_update(range2i()); break;
 		default: break;
 	}
     
@@ -442,6 +565,7 @@ enum MouseAction {
     mouse_edit_frame_rotate_x,
     mouse_edit_frame_rotate_y,
     mouse_edit_frame_rotate_z,
+    mouse_trace_crop,
 };
 
 MouseAction mouse_action = mouse_none; ///< mouse current action
@@ -463,15 +587,31 @@ void motion(int x, int y) {
         case mouse_edit_frame_rotate_x: selection_rotate(x3f*delta_f.y); break;
         case mouse_edit_frame_rotate_y: selection_rotate(y3f*delta_f.y); break;
         case mouse_edit_frame_rotate_z: selection_rotate(z3f*delta_f.y); break;
+        case mouse_trace_crop: {
+            auto a = trace_pixel(mouse_start.x,mouse_start.y), b = trace_pixel(x,y);
+            trace_crop_selecting = range2i(min(a,b),max(a,b));
+            glutPostRedisplay();
+            return;
+        }
         default: break;
     }
     mouse_last = vec2i(x,y);
-    trace_updated = true;
+    auto camera_only = mouse_action == mouse_turntable_rotate or mouse_action == mouse_turntable_dolly or
+                       mouse_action == mouse_turntable_pan;
+    if(camera_only) trace_camera_moved = true;
+    else trace_updated = true;
     glutPostRedisplay();
 }
 
 /// mouse button event handler
 void mouse(int button, int state, int x, int y) {
+    // crop windows are applied when released, as empty ones (clicks) clear the crop
+    if(state == GLUT_UP and mouse_action == mouse_trace_crop) {
+        auto crop = trace_crop_selecting;
+        trace_crop_selecting = range2i();
+        trace_crop_update((isvalid(crop) and crop.min.x < crop.max.x and crop.min.y < crop.max.y) ? crop : range2i());
+        glutPostRedisplay();
+    }
     mouse_start = vec2i(x,y);
     mouse_last = mouse_start;
     mouse_action = mouse_none;
@@ -495,6 +635,8 @@ void mouse(int button, int state, int x, int y) {
                 if(button == GLUT_RIGHT_BUTTON) mouse_action = mouse_edit_frame_move_z;
             }
         }
+    } else if(trace and (glutGetModifiers() & GLUT_ACTIVE_SHIFT) and x >= glutGet(GLUT_WINDOW_WIDTH) / 2) {
+        if(button == GLUT_LEFT_BUTTON) mouse_action = mouse_trace_crop;
     } else {
         if(button == GLUT_LEFT_BUTTON) mouse_action = mouse_turntable_rotate;
         if(button == GLUT_RIGHT_BUTTON) mouse_action = mouse_turntable_dolly;
@@ -551,6 +693,10 @@ void display_trace() {
     if(trace_updated) {
         trace_progressive_start();
         trace_updated = false;
+        trace_camera_moved = false;
+    } else if(trace_camera_moved) {
+        trace_progressive_reproject();
+        trace_camera_moved = false;
     }
     
     glViewport(w, 0, w, h);
@@ -566,6 +712,18 @@ void display_trace() {
     auto zoom = min(float(w) / trace_img.width(), float(h) / trace_img.height());
     glPixelZoom(zoom,-zoom);
     glDrawPixels(trace_img.width(), trace_img.height(), GL_RGB, GL_FLOAT, trace_img.data()->data());
+    
+    // outline the crop window being dragged, or the one traced
+    auto crop = (isvalid(trace_crop_selecting)) ? trace_crop_selecting : trace_opts.crop;
+    if(isvalid(crop)) {
+        glColor3f(1,1,0);
+        glBegin(GL_LINE_LOOP);
+        glVertex2f(crop.min.x*zoom, crop.min.y*zoom);
+        glVertex2f(crop.max.x*zoom, crop.min.y*zoom);
+        glVertex2f(crop.max.x*zoom, crop.max.y*zoom);
+        glVertex2f(crop.min.x*zoom, crop.max.y*zoom);
+        glEnd();
+    }
     glPopMatrix();
 }
 
@@ -597,6 +755,8 @@ void display_trace_hud() {
 /// main draw method
 void display() {
     if(draw_opts.cameralights) scene_cameralights_update(scene,draw_opts.cameralights_dir,draw_opts.cameralights_col);
+    // the tracing accelerators are built for the levels selected at init
+    if(lod and not trace) scene_lods_select(scene, scene->camera, draw_opts.res, lod_opts);
     draw_scene(scene,draw_opts,true);
     draw_scene_decorations(scene,draw_opts,false);
     
@@ -680,6 +840,8 @@ void parse_args(int argc, char** argv) {
         TCLAP::SwitchArg distributionArg("d","distribution_raytrace","Distribution Raytracing",cmd);
         TCLAP::SwitchArg pathArg("p","pathtrace","Pathtracing",cmd);
         
+        TCLAP::ValueArg<float> lodArg("","lod","Simplified meshes for distant surfaces, with this many pixels per triangle",false,1,"pixels",cmd);
+        
         TCLAP::UnlabeledValueArg<string> filenameScene("scene","Scene filename",true,"","scene",cmd);
         TCLAP::UnlabeledValueArg<string> filenameImage("image","Image filename",false,"","image",cmd);
         
@@ -688,6 +850,10 @@ void parse_args(int argc, char** argv) {
         if(traceArg.isSet()) trace = traceArg.getValue();
         if(distributionArg.isSet()) trace_distributed = distributionArg.getValue();
         if(pathArg.isSet()) trace_path = pathArg.getValue();
+        if(lodArg.isSet()) {
+            lod = lodArg.getValue() > 0;
+            lod_opts.pixels_per_triangle = lodArg.getValue();
+        }
 
         trace = trace or trace_distributed or trace_path;
         
@@ -32,6 +32,13 @@ void message_va(const char* msg, ...);
     fflush(stderr); assert(false); \
     } while(false)
 
+/// Same as ERROR_IF_NOT, but only checked in builds defining DEBUG_CHECKS (for checks in per-ray and per-sample code)
+#ifdef DEBUG_CHECKS
+#define DEBUG_ERROR_IF_NOT(cond, msg, ...) ERROR_IF_NOT(cond, msg , ## __VA_ARGS__ )
+#else
+#define DEBUG_ERROR_IF_NOT(cond, msg, ...) do { } while(false)
+#endif
+
 /// Prints a warning message (printf style)
 #define WARNING(msg, ...) do { \
     fprintf(stderr, "warning in function %s at %s:%d\n", __FUNCTION__, __FILE__, __LINE__); \
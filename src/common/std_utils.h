@@ -3,6 +3,8 @@
 
 #include "std.h"
 #include <chrono>
+#include <thread>
+#include <atomic>
 
 ///@file common/std_utils.h Utilities based on std. @ingroup common
 ///@defgroup std_utils Utilities based on std
@@ -37,6 +39,35 @@ struct timer_avg {
     double elapsed() { return (_count) ? _elapsed / _count : 0; }
 };
 
+/// number of worker threads used by parallel loops
+inline int parallel_nthreads() {
+    auto nthreads = (int)std::thread::hardware_concurrency();
+    return (nthreads > 0) ? nthreads : 1;
+}
+
+/// runs f(start,end) over contiguous chunks of [0,n) on parallel_nthreads() threads
+inline void parallel_for(int n, const function<void (int, int)>& f) {
+    auto nthreads = (parallel_nthreads() < n) ? parallel_nthreads() : n;
+    if(nthreads <= 1) { if(n > 0) f(0, n); return; }
+    auto threads = vector<std::thread>();
+    for(int t = 0; t < nthreads; t ++) {
+        threads.push_back(std::thread(f, (int)((long)n*t/nthreads), (int)((long)n*(t+1)/nthreads)));
+    }
+    for(auto& thread : threads) thread.join();
+}
+
+/// runs f(i,thread) for every i in [0,n) on parallel_nthreads() threads, handing out items one at a time
+/// so that uneven items balance across threads; thread is in [0,parallel_nthreads()) for per-thread state
+inline void parallel_for_dynamic(int n, const function<void (int, int)>& f) {
+    auto nthreads = (parallel_nthreads() < n) ? parallel_nthreads() : n;
+    std::atomic<int> next(0);
+    auto worker = [&](int thread) { for(auto i = next++; i < n; i = next++) f(i, thread); };
+    if(nthreads <= 1) { worker(0); return; }
+    auto threads = vector<std::thread>();
+    for(int t = 0; t < nthreads; t ++) threads.push_back(std::thread(worker, t));
+    for(auto& thread : threads) thread.join();
+}
+
 // TODO: this is only for small strings!!!
 template<typename T>
 inline static string _to_string(const char* fmt, const T& value) {
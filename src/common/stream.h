@@ -116,66 +116,245 @@ struct JsonOutputStream : StructuredStream {
     }
 };
 
-/// Stream to read JSON
+/// Stream to read JSON, parsing values in place from the text instead of building a document tree: objects
+/// are indexed when entered, with a single scan recording the key, position and size of their members (since
+/// serializers ask for members in code order, not file order), and numbers are parsed straight into the
+/// destination arrays
 struct JsonInputStream : StructuredStream {
-    vector<int>                     _stack;
-    vector<vector<string>>          _used_vars;
-    vector<int>                     _array_idx;
-    ParsedJson*                     _json = nullptr;
+    /// object member, as found by the scan of its object
+    struct _Member {
+        unsigned    key = 0; ///< hash of the name
+        int         name = 0, name_size = 0; ///< name position and length
+        int         value = 0; ///< value position
+        int         size = -1; ///< number of elements (arrays only)
+        bool        used = false; ///< whether the member was read
+    };
+    /// value being read
+    struct _Cursor {
+        int         value; ///< value position
+        int         size; ///< number of elements if known (arrays only, -1 otherwise)
+    };
     
-    JsonInputStream(FILE* f) { _json = new ParsedJson(f); _stack.push_back(0); }
-    virtual ~JsonInputStream() { if(_json) delete _json; }
+    string                          _json; ///< text
+    vector<_Cursor>                 _stack; ///< values being read, innermost last
+    vector<_Member>                 _members; ///< members of the objects being read
+    vector<int>                     _objects; ///< first member of each object being read
+    vector<int>                     _array_next; ///< next element position of each array being read
+    bool                            _recover = false; ///< whether errors are recorded in error instead of stopping
+    string                          error; ///< first error when recovering from errors (reads do nothing after it)
+    
+    JsonInputStream(FILE* f) { _read(f); _init(); }
+    /// with recover, malformed text sets error instead of stopping, e.g. for input from clients
+    JsonInputStream(const string& json, bool recover = false) : _json(json), _recover(recover) { _init(); }
     
     virtual bool is_reading() { return true; }
 
-    virtual bool null() { return _json->is_null(_stack.back()); }
+    virtual bool null() { return _failed() or _json[_value()] == 'n'; }
     
-    virtual void value(bool& value) { _json->get_value(_stack.back(),value); }
-    virtual void value(int& value) { _json->get_value(_stack.back(),value); }
-    virtual void value(float& value) { _json->get_value(_stack.back(),value); }
-    virtual void value(double& value) { _json->get_value(_stack.back(),value); }
-    virtual void value(string& value) { _json->get_value(_stack.back(),value); }
+    virtual void value(bool& value) {
+        if(_failed()) return;
+        auto v = _value();
+        if(not _json.compare(v, 4, "true")) value = true;
+        else if(not _json.compare(v, 5, "false")) value = false;
+        else _error(v, "bool expected");
+    }
+    virtual void value(int& value) { if(not _failed()) _number(_value(), value); }
+    virtual void value(float& value) { if(not _failed()) _number(_value(), value); }
+    virtual void value(double& value) { if(not _failed()) _number(_value(), value); }
+    virtual void value(string& value) { if(not _failed()) _string(_value(), value); }
     virtual void value(const char* value) { ERROR("should not have gotten here"); }
     
     virtual void array(int* values, int n) { _array(values, n); }
     virtual void array(float* values, int n) { _array(values, n); }
     virtual void array(double* values, int n) { _array(values, n); }
     
-    virtual int array_size() { return _json->get_array_size(_stack.back()); }
+    virtual int array_size() {
+        if(_failed()) return 0;
+        auto& cursor = _stack.back();
+        if(cursor.size < 0 and _expect(cursor.value, '[', "array expected")) _skip(cursor.value, &cursor.size);
+        return (_failed()) ? 0 : cursor.size;
+    }
     
-    virtual void array_begin() { _array_idx.push_back(0); }
-    virtual void array_end() { _array_idx.pop_back(); }
+    virtual void array_begin() { if(_failed()) return; _expect(_value(), '[', "array expected"); _array_next.push_back(_skipws(_value()+1)); }
+    virtual void array_end() { if(not _failed()) _array_next.pop_back(); }
     
-    virtual void array_elem_begin() { _stack.push_back(_json->get_child(_stack.back(),_array_idx.back())); }
-    virtual void array_elem_end() { _stack.pop_back(); _array_idx.back() += 1; }
+    virtual void array_elem_begin() {
+        if(_failed()) return;
+        if(_json[_array_next.back()] == ']') _error(_array_next.back(), "index out of range");
+        _stack.push_back(_Cursor{_array_next.back(), -1});
+    }
+    virtual void array_elem_end() {
+        if(_failed()) return;
+        auto next = _skipws(_skip(_value(), nullptr));
+        if(_json[next] == ',') next = _skipws(next+1);
+        _stack.pop_back();
+        _array_next.back() = next;
+    }
     
-    virtual void struct_begin() { _used_vars.push_back(vector<string>()); }
+    virtual void struct_begin() {
+        if(_failed()) return;
+        auto cur = _value();
+        _objects.push_back(_members.size());
+        if(not _expect(cur, '{', "object expected")) return;
+        cur = _skipws(cur+1);
+        while(_json[cur] != '}') {
+            if(not _expect(cur, '"', "string expected")) return;
+            auto member = _Member();
+            member.name = cur+1;
+            cur = _skip(cur, nullptr);
+            member.name_size = cur-1-member.name;
+            member.key = _key(_json.c_str()+member.name, member.name_size);
+            cur = _skipws(cur);
+            if(not _expect(cur, ':', ": expected")) return;
+            member.value = _skipws(cur+1);
+            cur = _skipws(_skip(member.value, (_json[member.value] == '[') ? &member.size : nullptr));
+            _members.push_back(member);
+            if(_json[cur] == ',') cur = _skipws(cur+1);
+            else if(not _expect(cur, '}', "} or , expected")) return;
+        }
+    }
     virtual void struct_end() {
-        for(int i = 0; i < _json->get_size(_stack.back()); i += 2) {
-            string name;
-            _json->get_value(_json->get_child(_stack.back(),i),name);
+        if(_failed()) return;
+        for(auto m = _objects.back(); m < _members.size(); m ++) {
+            if(_members[m].used) continue;
+            auto name = _json.substr(_members[m].name, _members[m].name_size);
             if(name == "_type" or name == "_id" or name == "_comment") continue;
-            bool found = false;
-            for(auto vv : _used_vars.back()) { found = vv == name; if(found) break; }
-            WARNING_IF_NOT(found, "unknown member %s", name.c_str());
+            WARNING("unknown member %s", name.c_str());
         }
-        _used_vars.pop_back();
+        _members.resize(_objects.back());
+        _objects.pop_back();
     }
     
-    virtual bool struct_has_member(const char* name) { return _json->has_object_member(_stack.back(),name); }
+    virtual bool struct_has_member(const char* name) { return not _failed() and _find_member(name) >= 0; }
     virtual bool struct_member_begin(const char* name) {
-        if(struct_has_member(name)) {
-            _used_vars.back().push_back(name);
-            _stack.push_back(_json->get_object_member(_stack.back(),name));
-            return true;
-        } else return false;
+        if(_failed()) return false;
+        auto m = _find_member(name);
+        if(m < 0) return false;
+        _members[m].used = true;
+        _stack.push_back(_Cursor{_members[m].value, _members[m].size});
+        return true;
+    }
+    virtual void struct_member_end() { if(not _failed()) _stack.pop_back(); }
+    
+    void _read(FILE* f) {
+        char buf[65536];
+        size_t n;
+        while((n = fread(buf, 1, sizeof(buf), f)) > 0) _json.append(buf, n);
+    }
+    void _init() {
+        auto root = _skipws(0);
+        if(_skipws(_skip(root, nullptr)) != _json.size()) _error(root, "json not closed");
+        _stack.push_back(_Cursor{root, -1});
+    }
+    
+    int _value() { return _stack.back().value; }
+    
+    // FNV-1a hash of member names
+    unsigned _key(const char* name, int size) {
+        auto key = 2166136261u;
+        for(int i = 0; i < size; i ++) key = (key ^ (unsigned char)name[i]) * 16777619u;
+        return key;
+    }
+    int _find_member(const char* name) {
+        auto size = (int)strlen(name);
+        auto key = _key(name, size);
+        for(auto m = _objects.back(); m < _members.size(); m ++) {
+            auto& member = _members[m];
+            if(member.key == key and member.name_size == size and not _json.compare(member.name, size, name)) return m;
+        }
+        return -1;
+    }
+    
+    bool _failed() { return not error.empty(); }
+    void _error(int cur, const char* msg) {
+        auto line = 1;
+        for(int i = 0; i < cur and i < _json.size(); i ++) if(_json[i] == '\n') line ++;
+        if(not _recover) ERROR("%s at line %d", msg, line);
+        if(_failed()) return;
+        char buf[256];
+        snprintf(buf, sizeof(buf), "%s at line %d", msg, line);
+        error = buf;
+    }
+    bool _expect(int cur, char c, const char* msg) { if(_json[cur] == c) return true; _error(cur, msg); return false; }
+    int _skipws(int cur) {
+        while(_json[cur] == ' ' or _json[cur] == '\t' or _json[cur] == '\r' or _json[cur] == '\n') cur++;
+        return cur;
+    }
+    
+    // position after the value at cur; for arrays, also counts their elements
+    int _skip(int cur, int* count) {
+        if(_json[cur] == '"') {
+            for(cur ++; cur < (int)_json.size() and _json[cur] != '"'; cur ++) {
+                if(_json[cur] == '\\' and ++ cur >= (int)_json.size()) break;
+            }
+            if(cur >= (int)_json.size()) { _error(cur, "string not closed"); return _json.size(); }
+            return cur+1;
+        }
+        if(_json[cur] != '{' and _json[cur] != '[') {
+            auto start = cur;
+            while(cur < _json.size() and not strchr(",:]} \t\r\n", _json[cur])) cur ++;
+            if(cur == start) _error(cur, "value expected");
+            return cur;
+        }
+        // elements are counted when they start, so that trailing commas are tolerated
+        auto depth = 0, elements = 0;
+        auto element = false;
+        for(; cur < _json.size(); cur ++) {
+            auto c = _json[cur];
+            if(c == ' ' or c == '\t' or c == '\r' or c == '\n') continue;
+            if(depth == 1 and c == ',') { element = false; continue; }
+            if(depth == 1 and c != '}' and c != ']' and not element) { element = true; elements ++; }
+            if(c == '"') cur = _skip(cur, nullptr) - 1;
+            else if(c == '{' or c == '[') depth ++;
+            else if(c == '}' or c == ']') { if(not --depth) { if(count) *count = elements; return cur+1; } }
+        }
+        _error(cur, "value not closed");
+        return cur;
+    }
+    
+    void _string(int cur, string& value) {
+        if(not _expect(cur, '"', "string expected")) return;
+        value.clear();
+        for(cur ++; cur < (int)_json.size() and _json[cur] != '"'; cur ++) {
+            if(_json[cur] != '\\') { value += _json[cur]; continue; }
+            if(++ cur >= (int)_json.size()) break;
+            switch(_json[cur]) {
+                case '"': case '\\': case '/': value += _json[cur]; break;
+                case 'b': value += '\b'; break;
+                case 'f': value += '\f'; break;
+                case 'n': value += '\n'; break;
+                case 'r': value += '\r'; break;
+                case 't': value += '\t'; break;
+                case 'u': _error(cur, "unsupported unicode strings"); return;
+                default: _error(cur, "unknown string escape"); return;
+            }
+        }
+        if(cur >= (int)_json.size()) _error(cur, "string not closed");
+    }
+    
+    // number at cur, returning the position after it (strtod and friends do not scan the rest of the text,
+    // which sscanf does on every call)
+    int _parse(int cur, int& value) { char* end; value = strtol(_json.c_str()+cur, &end, 10); return end - _json.c_str(); }
+    int _parse(int cur, float& value) { char* end; value = strtof(_json.c_str()+cur, &end); return end - _json.c_str(); }
+    int _parse(int cur, double& value) { char* end; value = strtod(_json.c_str()+cur, &end); return end - _json.c_str(); }
+    template<typename T>
+    int _number(int cur, T& value) {
+        auto end = _parse(cur, value);
+        if(end == cur) _error(cur, "number expected");
+        return end;
     }
-    virtual void struct_member_end() { _stack.pop_back(); }
     
     template<typename T>
     void _array(T* values, int n) {
+        if(_failed()) return;
+        auto cur = _value();
+        if(not _expect(cur, '[', "array expected")) return;
+        cur = _skipws(cur+1);
         for(int i = 0; i < n; i ++) {
-            _json->get_value(_json->get_array_member(_stack.back(), i), values[i]);
+            if(_json[cur] == ']') { _error(cur, "index out of range"); return; }
+            cur = _skipws(_number(cur, values[i]));
+            if(_json[cur] == ',') cur = _skipws(cur+1);
+            else if(not _expect(cur, ']', "] or , expected")) return;
         }
     }
 };
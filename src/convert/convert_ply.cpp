@@ -1,4 +1,5 @@
 #include "igl/serialize.h"
+#include "igl/mapped.h"
 #include <tclap/CmdLine.h>
 
 ///@file convert/convert_ply.cpp ConvertPly: Converter from PLY @ingroup apps
@@ -8,6 +9,7 @@
 
 string filename_ply;
 string filename_igl;
+string filename_mapped;
 
 bool flipface = false;
 bool normalizesize = false;
@@ -159,6 +161,7 @@ void parse_args(int argc, char** argv) {
         TCLAP::SwitchArg flipyzArg("y","flipyz","Flip Y and Z coordinates",cmd);
         TCLAP::SwitchArg normalizeSizeArg("n","normalize","Normalize in the unit cube",cmd);
         TCLAP::SwitchArg flipfaceArg("f","flipface","Flip face winding",cmd);
+        TCLAP::ValueArg<string> mappedArg("m","mapped","Write mesh and bvh to this binary file and reference it as a MappedMesh",false,"","filename",cmd);
         
         TCLAP::UnlabeledValueArg<string> filenamePlyArg("ply","Ply filename",true,"","ply mesh",cmd);
         TCLAP::UnlabeledValueArg<string> filenameIglArg("igl","Igl filename",true,"","igl mesh",cmd);
@@ -168,6 +171,7 @@ void parse_args(int argc, char** argv) {
         flipyz = flipyzArg.getValue();
         normalizesize = normalizeSizeArg.getValue();
         flipface = flipfaceArg.getValue();
+        if(mappedArg.isSet()) filename_mapped = mappedArg.getValue();
         
         filename_ply = filenamePlyArg.getValue();
         filename_igl = filenameIglArg.getValue();
@@ -179,7 +183,14 @@ void parse_args(int argc, char** argv) {
 int main(int argc, char** argv) {
     parse_args(argc,argv);
     auto mesh = read_ply(filename_ply, flipface, normalizesize, flipyz);
-    Serializer::write_json(mesh, filename_igl, false);
+    if(not filename_mapped.empty()) {
+        ERROR_IF_NOT(mesh, "cannot write empty mesh");
+        if(is<TriangleMesh>(mesh)) mesh = trianglemesh_to_mesh(cast<TriangleMesh>(mesh));
+        mappedmesh_write(filename_mapped, cast<Mesh>(mesh), true);
+        auto mapped = new MappedMesh();
+        mapped->filename = filename_mapped;
+        Serializer::write_json(mapped, filename_igl, false);
+    } else Serializer::write_json(mesh, filename_igl, false);
 }
 
 ///@}
@@ -5,13 +5,13 @@
 struct _BVHBoxedPrim { int i; range3f bbox; vec3f center; };
 
 bool intersect_bvhnode_first(BVHAccelerator* bvh, int nodeid, const ray3f& ray, intersection3f& intersection) {
-    auto& node = bvh->nodes[nodeid];
+    auto& node = bvh->node(nodeid);
     if(not intersect_bbox(ray, node.bbox)) return false;
     bool hit = false; float mint = ray3f::rayinf;
     ray3f sray = ray;
     if(node.leaf) {
         for(auto idx : range(node.start,node.end)) {
-            auto i = bvh->sorted_prims[idx];
+            auto i = bvh->sorted_prim(idx);
             intersection3f sintersection;
             if(bvh->_intersect_elem_first(i, sray, sintersection)) {
                 if(mint > sintersection.ray_t) {
@@ -43,11 +43,11 @@ bool intersect_bvh_first(BVHAccelerator* bvh, const ray3f& ray, intersection3f&
 }
 
 bool intersect_bvhnode_any(BVHAccelerator* bvh, int nodeid, const ray3f& ray) {
-    auto& node = bvh->nodes[nodeid];
+    auto& node = bvh->node(nodeid);
     if(not intersect_bbox(ray, node.bbox)) return false;
     if(node.leaf) {
         for(auto idx : range(node.start,node.end)) {
-            auto i = bvh->sorted_prims[idx];
+            auto i = bvh->sorted_prim(idx);
             if(bvh->_intersect_elem_any(i,ray)) return true;
         }
     } else {
@@ -100,7 +100,403 @@ void intersect_bvh_build_node(BVHAccelerator* bvh, int nodeid, vector<_BVHBoxedP
     bvh->nodes[nodeid] = node;
 }
 
+range3f intersect_sbvh_clip_prim(BVHAccelerator* bvh, const _BVHBoxedPrim& prim, const range3f& bbox) {
+    if(bvh->_intersect_elem_clipped_bounds) return rintersect(prim.bbox, bvh->_intersect_elem_clipped_bounds(prim.i, bbox));
+    else return rintersect(prim.bbox, bbox);
+}
+
+void intersect_sbvh_split_bbox(const range3f& bbox, int axis, float pos, range3f& left, range3f& right) {
+    left = bbox; left.max[axis] = pos;
+    right = bbox; right.min[axis] = pos;
+}
+
+// SAH sweep over primitive centers, returns the split index (prims are left sorted along axis)
+float intersect_sbvh_object_split(vector<_BVHBoxedPrim>& prim, int& axis, int& split, range3f& left, range3f& right) {
+    auto best_cost = ray3f::rayinf;
+    auto n = (int)prim.size();
+    auto right_area = vector<float>(n);
+    for(int a = 0; a < 3; a ++) {
+        std::sort(prim.begin(), prim.end(), [a](const _BVHBoxedPrim& i, const _BVHBoxedPrim& j) { return i.center[a] < j.center[a]; });
+        range3f bbox;
+        for(int i = n-1; i > 0; i --) { bbox = runion(bbox, prim[i].bbox); right_area[i] = area(bbox); }
+        bbox = range3f();
+        for(int i = 1; i < n; i ++) {
+            bbox = runion(bbox, prim[i-1].bbox);
+            auto cost = area(bbox) * i + right_area[i] * (n-i);
+            if(cost < best_cost) { best_cost = cost; axis = a; split = i; }
+        }
+    }
+    std::sort(prim.begin(), prim.end(), [axis](const _BVHBoxedPrim& i, const _BVHBoxedPrim& j) { return i.center[axis] < j.center[axis]; });
+    left = range3f(); right = range3f();
+    for(int i = 0; i < split; i ++) left = runion(left, prim[i].bbox);
+    for(int i = split; i < n; i ++) right = runion(right, prim[i].bbox);
+    return best_cost;
+}
+
+// SAH over spatial bins, clipping primitives against the bin boundaries
+float intersect_sbvh_spatial_split(BVHAccelerator* bvh, const vector<_BVHBoxedPrim>& prim, const range3f& bbox, int& axis, float& pos) {
+    const int nbins = BVHAccelerator::spatial_split_bins;
+    auto best_cost = ray3f::rayinf;
+    for(int a = 0; a < 3; a ++) {
+        auto extent = size(bbox)[a];
+        if(extent <= 0) continue;
+        range3f bins[nbins]; int enter[nbins] = {0}, exit[nbins] = {0};
+        auto bin_pos = [&](int b) { return bbox.min[a] + extent * b / nbins; };
+        for(auto& p : prim) {
+            auto first = clamp((int)((p.bbox.min[a]-bbox.min[a]) / extent * nbins), 0, nbins-1);
+            auto last = clamp((int)((p.bbox.max[a]-bbox.min[a]) / extent * nbins), first, nbins-1);
+            for(int b = first; b <= last; b ++) {
+                auto bin_bbox = bbox; bin_bbox.min[a] = bin_pos(b); bin_bbox.max[a] = bin_pos(b+1);
+                bins[b] = runion(bins[b], (first == last) ? p.bbox : intersect_sbvh_clip_prim(bvh, p, bin_bbox));
+            }
+            enter[first] ++; exit[last] ++;
+        }
+        float right_area[nbins]; int right_count[nbins];
+        range3f right; int nright = 0;
+        for(int b = nbins-1; b > 0; b --) { right = runion(right, bins[b]); nright += exit[b]; right_area[b] = area(right); right_count[b] = nright; }
+        range3f left; int nleft = 0;
+        for(int b = 1; b < nbins; b ++) {
+            left = runion(left, bins[b-1]); nleft += enter[b-1];
+            if(nleft == 0 or right_count[b] == 0) continue;
+            auto cost = area(left) * nleft + right_area[b] * right_count[b];
+            if(cost < best_cost) { best_cost = cost; axis = a; pos = bin_pos(b); }
+        }
+    }
+    return best_cost;
+}
+
+void intersect_sbvh_build_node(BVHAccelerator* bvh, int nodeid, vector<_BVHBoxedPrim>& prim, float root_area, int& budget) {
+    range3f bbox;
+    auto node = BVHNode();
+    for(auto& p : prim) bbox = runion(bbox,p.bbox);
+    node.bbox = bbox;
+    if(prim.size() <= BVHAccelerator::min_prims) {
+        node.leaf = true;
+        node.start = bvh->sorted_prims.size();
+        for(auto& p : prim) bvh->sorted_prims.push_back(p.i);
+        node.end = bvh->sorted_prims.size();
+        bvh->nodes[nodeid] = node;
+        return;
+    }
+    
+    auto left = vector<_BVHBoxedPrim>(), right = vector<_BVHBoxedPrim>();
+    int object_axis = 0, object_split = 0;
+    range3f object_left, object_right;
+    auto object_cost = intersect_sbvh_object_split(prim, object_axis, object_split, object_left, object_right);
+    
+    // try spatial splits only when the object split children overlap and duplication is still allowed
+    int spatial_axis = 0; float spatial_pos = 0;
+    auto spatial_cost = ray3f::rayinf;
+    if(budget > 0 and area(rintersect(object_left, object_right)) > BVHAccelerator::spatial_split_alpha * root_area) {
+        spatial_cost = intersect_sbvh_spatial_split(bvh, prim, bbox, spatial_axis, spatial_pos);
+    }
+    
+    if(spatial_cost < object_cost) {
+        range3f left_bbox, right_bbox;
+        intersect_sbvh_split_bbox(bbox, spatial_axis, spatial_pos, left_bbox, right_bbox);
+        // duplicates are only charged to the budget if the split is kept
+        auto duplicates = 0;
+        for(auto& p : prim) {
+            if(p.bbox.max[spatial_axis] <= spatial_pos) left.push_back(p);
+            else if(p.bbox.min[spatial_axis] >= spatial_pos) right.push_back(p);
+            else if(duplicates >= budget) (p.center[spatial_axis] < spatial_pos ? left : right).push_back(p);
+            else {
+                auto lp = p, rp = p;
+                lp.bbox = intersect_sbvh_clip_prim(bvh, p, left_bbox);
+                rp.bbox = intersect_sbvh_clip_prim(bvh, p, right_bbox);
+                lp.center = center(lp.bbox); rp.center = center(rp.bbox);
+                if(isvalid(lp.bbox)) left.push_back(lp);
+                if(isvalid(rp.bbox)) right.push_back(rp);
+                if(isvalid(lp.bbox) and isvalid(rp.bbox)) duplicates ++;
+            }
+        }
+        // spatial split did not separate anything: use the object split
+        if(left.empty() or right.empty() or left.size() == prim.size() or right.size() == prim.size()) {
+            left.clear(); right.clear();
+            intersect_sbvh_object_split(prim, object_axis, object_split, object_left, object_right);
+        }
+        else budget -= duplicates;
+    }
+    if(left.empty() and right.empty()) {
+        // object split (median split if sah found no valid split)
+        if(object_split <= 0 or object_split >= prim.size()) object_split = prim.size()/2;
+        left.assign(prim.begin(), prim.begin()+object_split);
+        right.assign(prim.begin()+object_split, prim.end());
+    }
+    prim.clear(); prim.shrink_to_fit();
+    
+    node.leaf = false;
+    node.n0 = bvh->nodes.size();
+    bvh->nodes.push_back(BVHNode());
+    node.n1 = bvh->nodes.size();
+    bvh->nodes.push_back(BVHNode());
+    intersect_sbvh_build_node(bvh,node.n0,left,root_area,budget);
+    intersect_sbvh_build_node(bvh,node.n1,right,root_area,budget);
+    bvh->nodes[nodeid] = node;
+}
+
+// 30-bit Morton code of a point in the unit cube (10 bits per axis, interleaved from x)
+unsigned int intersect_lbvh_morton(const vec3f& p) {
+    auto spread = [](unsigned int v) {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    };
+    auto quantize = [](float x) { return (unsigned int)clamp(x * 1024, 0.0f, 1023.0f); };
+    return (spread(quantize(p.x)) << 2) | (spread(quantize(p.y)) << 1) | spread(quantize(p.z));
+}
+
+// sorts ids by codes with a parallel least-significant-digit radix sort: chunks count their digits, offsets are
+// laid out digit by digit and chunk by chunk (so that the sort is stable), then chunks scatter concurrently
+void intersect_lbvh_sort(vector<unsigned int>& codes, vector<int>& ids) {
+    const int digit_bits = 10, digits = 1 << digit_bits;
+    auto n = (int)codes.size();
+    auto nchunks = max(1,min(parallel_nthreads(), n / digits));
+    auto chunk = [&](int c, int& start, int& end) { start = (long)n*c/nchunks; end = (long)n*(c+1)/nchunks; };
+    auto sorted_codes = vector<unsigned int>(n);
+    auto sorted_ids = vector<int>(n);
+    auto offsets = vector<int>(nchunks*digits);
+    for(int shift = 0; shift < 30; shift += digit_bits) {
+        parallel_for_dynamic(nchunks, [&](int c, int thread) {
+            int start, end; chunk(c, start, end);
+            auto count = offsets.data() + c*digits;
+            for(int d = 0; d < digits; d ++) count[d] = 0;
+            for(int i = start; i < end; i ++) count[(codes[i] >> shift) & (digits-1)] ++;
+        });
+        auto offset = 0;
+        for(int d = 0; d < digits; d ++) {
+            for(int c = 0; c < nchunks; c ++) { auto count = offsets[c*digits+d]; offsets[c*digits+d] = offset; offset += count; }
+        }
+        parallel_for_dynamic(nchunks, [&](int c, int thread) {
+            int start, end; chunk(c, start, end);
+            auto offset = offsets.data() + c*digits;
+            for(int i = start; i < end; i ++) {
+                auto o = offset[(codes[i] >> shift) & (digits-1)] ++;
+                sorted_codes[o] = codes[i];
+                sorted_ids[o] = ids[i];
+            }
+        });
+        std::swap(codes, sorted_codes);
+        std::swap(ids, sorted_ids);
+    }
+}
+
+// split of the sorted codes in [start,end): the first code with the highest bit that differs in the range set
+// (the middle if all codes are equal)
+int intersect_lbvh_split(const vector<unsigned int>& codes, int start, int end) {
+    auto first = codes[start], last = codes[end-1];
+    if(first == last) return (start+end)/2;
+    auto prefix = __builtin_clz(first ^ last);
+    // binary search for the last code sharing more than prefix bits with the first
+    auto split = start, step = end-1-start;
+    do {
+        step = (step+1)/2;
+        if(split+step < end-1 and __builtin_clz(first ^ codes[split+step]) > prefix) split += step;
+    } while(step > 1);
+    return split+1;
+}
+
+// linear bvh nodes with their SAH cost (unit traversal and intersection costs, as in intersect_bvh_stats)
+struct _BVHLinearNodes {
+    vector<BVHNode>     nodes; ///< nodes
+    vector<float>       costs; ///< SAH cost of each node's subtree
+};
+
+// builds the subtree of the sorted elements in [start,end) at nodeid; children are appended after their parent,
+// so reverse node order visits children before parents
+void intersect_lbvh_build_node(_BVHLinearNodes& lin, int nodeid, const vector<unsigned int>& codes, const vector<range3f>& bboxes, int start, int end) {
+    auto node = BVHNode();
+    if(end-start <= BVHAccelerator::min_prims) {
+        range3f bbox;
+        for(auto i : range(start, end)) bbox = runion(bbox,bboxes[i]);
+        node.bbox = bbox;
+        node.leaf = true;
+        node.start = start;
+        node.end = end;
+        lin.nodes[nodeid] = node;
+        lin.costs[nodeid] = area(bbox) * (end-start);
+        return;
+    }
+    auto middle = intersect_lbvh_split(codes, start, end);
+    node.leaf = false;
+    node.n0 = lin.nodes.size();
+    node.n1 = lin.nodes.size()+1;
+    lin.nodes.resize(lin.nodes.size()+2);
+    lin.costs.resize(lin.costs.size()+2);
+    intersect_lbvh_build_node(lin, node.n0, codes, bboxes, start, middle);
+    intersect_lbvh_build_node(lin, node.n1, codes, bboxes, middle, end);
+    node.bbox = runion(lin.nodes[node.n0].bbox, lin.nodes[node.n1].bbox);
+    lin.nodes[nodeid] = node;
+    lin.costs[nodeid] = area(node.bbox) + lin.costs[node.n0] + lin.costs[node.n1];
+}
+
+// restructures the treelet rooted at nodeid to its SAH-optimal topology (Karras and Aila 2013): the treelet grows
+// by opening its largest internal leaf, the best partition of every subset of its leaves is found bottom-up,
+// and the treelet internal nodes are reused for the new topology if it is cheaper
+void intersect_lbvh_restructure(_BVHLinearNodes& lin, int nodeid) {
+    const int nleaves = BVHAccelerator::treelet_leaves;
+    auto& root = lin.nodes[nodeid];
+    if(root.leaf) return;
+    lin.costs[nodeid] = area(root.bbox) + lin.costs[root.n0] + lin.costs[root.n1];
+    int leaves[nleaves], internals[nleaves]; int nl = 0, ni = 0;
+    leaves[nl++] = root.n0; leaves[nl++] = root.n1; internals[ni++] = nodeid;
+    while(nl < nleaves) {
+        auto best = -1; auto best_area = -1.0f;
+        for(int l = 0; l < nl; l ++) {
+            if(lin.nodes[leaves[l]].leaf) continue;
+            auto a = area(lin.nodes[leaves[l]].bbox);
+            if(a > best_area) { best_area = a; best = l; }
+        }
+        if(best < 0) break;
+        auto opened = leaves[best];
+        internals[ni++] = opened;
+        leaves[best] = lin.nodes[opened].n0;
+        leaves[nl++] = lin.nodes[opened].n1;
+    }
+    if(nl < BVHAccelerator::treelet_leaves) return;
+    
+    auto nsets = 1 << nl;
+    range3f bbox[1 << nleaves]; float cost[1 << nleaves]; int partition[1 << nleaves];
+    for(int s = 1; s < nsets; s ++) {
+        auto low = s & -s;
+        if(s == low) {
+            auto l = __builtin_ctz(s);
+            bbox[s] = lin.nodes[leaves[l]].bbox;
+            cost[s] = lin.costs[leaves[l]];
+            continue;
+        }
+        bbox[s] = runion(bbox[low], bbox[s ^ low]);
+        // partitions whose first side holds the lowest leaf, so that each is visited once
+        auto rest = s ^ low;
+        auto best = ray3f::rayinf;
+        for(auto q = rest & (rest-1); ; q = (q-1) & rest) {
+            auto c = cost[q | low] + cost[rest ^ q];
+            if(c < best) { best = c; partition[s] = q | low; }
+            if(not q) break;
+        }
+        cost[s] = area(bbox[s]) + best;
+    }
+    if(cost[nsets-1] >= lin.costs[nodeid] * (1 - 1e-5f)) return;
+    
+    // emit the new topology, with the treelet root kept in place since its parent points to it
+    auto next = 0;
+    function<int (int,int)> emit = [&](int s, int id) {
+        if((s & -s) == s) return leaves[__builtin_ctz(s)];
+        if(id < 0) id = internals[next++];
+        else next ++;
+        auto node = BVHNode();
+        node.leaf = false;
+        node.n0 = emit(partition[s], -1);
+        node.n1 = emit(s ^ partition[s], -1);
+        node.bbox = bbox[s];
+        lin.nodes[id] = node;
+        lin.costs[id] = cost[s];
+        return id;
+    };
+    emit(nsets-1, nodeid);
+}
+
+// restructures treelets in the subtree at nodeid, children before parents, without descending into nodes from limit on
+void intersect_lbvh_restructure_subtree(_BVHLinearNodes& lin, int nodeid, int limit) {
+    auto order = vector<int>();
+    auto stack = vector<int>{ nodeid };
+    while(not stack.empty()) {
+        auto i = stack.back(); stack.pop_back();
+        order.push_back(i);
+        auto& node = lin.nodes[i];
+        if(node.leaf) continue;
+        if(node.n0 < limit) stack.push_back(node.n0);
+        if(node.n1 < limit) stack.push_back(node.n1);
+    }
+    for(auto i = order.rbegin(); i != order.rend(); ++i) intersect_lbvh_restructure(lin, *i);
+}
+
+// linear bvh build: Morton codes of the element centers in their bounding box, radix sort, then top-down splits
+// at the highest differing code bit; the top of the tree is built serially and its subtrees in parallel, each in
+// its own node array that is then appended, and treelets are restructured bottom-up within subtrees first
+void intersect_lbvh_build(BVHAccelerator* bvh) {
+    auto n = bvh->_intersect_elem_num;
+    auto bboxes = vector<range3f>(n);
+    parallel_for(n, [&](int start, int end) {
+        for(int i = start; i < end; i ++) bboxes[i] = rscale(bvh->_intersect_elem_bounds(i),1+BVHAccelerator::epsilon);
+    });
+    range3f cbbox;
+    for(auto& b : bboxes) cbbox = runion(cbbox, center(b));
+    auto extent = max(size(cbbox), vec3f(1e-20f,1e-20f,1e-20f));
+    
+    auto codes = vector<unsigned int>(n);
+    auto ids = vector<int>(n);
+    parallel_for(n, [&](int start, int end) {
+        for(int i = start; i < end; i ++) { codes[i] = intersect_lbvh_morton((center(bboxes[i])-cbbox.min)/extent); ids[i] = i; }
+    });
+    intersect_lbvh_sort(codes, ids);
+    auto sorted_bboxes = vector<range3f>(n);
+    parallel_for(n, [&](int start, int end) { for(int i = start; i < end; i ++) sorted_bboxes[i] = bboxes[ids[i]]; });
+    bboxes.clear(); bboxes.shrink_to_fit();
+    
+    // top of the tree: split until ranges are small enough to balance across threads
+    auto task_size = max(BVHAccelerator::min_prims+1, n / (8*parallel_nthreads()));
+    auto top = _BVHLinearNodes();
+    auto tasks = vector<vec3i>(); // node, start, end
+    top.nodes.push_back(BVHNode()); top.costs.push_back(0);
+    auto stack = vector<vec3i>{ vec3i(0,0,n) };
+    while(not stack.empty()) {
+        auto t = stack.back(); stack.pop_back();
+        if(t.z-t.y <= task_size) { tasks.push_back(t); continue; }
+        auto middle = intersect_lbvh_split(codes, t.y, t.z);
+        auto node = BVHNode();
+        node.leaf = false;
+        node.n0 = top.nodes.size();
+        node.n1 = top.nodes.size()+1;
+        top.nodes[t.x] = node;
+        top.nodes.resize(top.nodes.size()+2); top.costs.resize(top.costs.size()+2);
+        stack.push_back(vec3i(node.n1,middle,t.z));
+        stack.push_back(vec3i(node.n0,t.y,middle));
+    }
+    
+    auto subtrees = vector<_BVHLinearNodes>(tasks.size());
+    parallel_for_dynamic(tasks.size(), [&](int k, int thread) {
+        auto& lin = subtrees[k];
+        lin.nodes.push_back(BVHNode()); lin.costs.push_back(0);
+        intersect_lbvh_build_node(lin, 0, codes, sorted_bboxes, tasks[k].y, tasks[k].z);
+        for(int pass = 0; pass < bvh->treelet_passes; pass ++) intersect_lbvh_restructure_subtree(lin, 0, lin.nodes.size());
+    });
+    
+    // append subtrees, with their roots in the top node they were built for
+    auto ntop = (int)top.nodes.size();
+    auto offsets = vector<int>(tasks.size());
+    auto nnodes = ntop;
+    for(auto k : range(tasks.size())) { offsets[k] = nnodes; nnodes += subtrees[k].nodes.size() - 1; }
+    top.nodes.resize(nnodes); top.costs.resize(nnodes);
+    parallel_for_dynamic(tasks.size(), [&](int k, int thread) {
+        auto& lin = subtrees[k];
+        auto global = [&](int i) { return (i == 0) ? tasks[k].x : offsets[k]+i-1; };
+        for(auto i : range(lin.nodes.size())) {
+            auto node = lin.nodes[i];
+            if(not node.leaf) { node.n0 = global(node.n0); node.n1 = global(node.n1); }
+            top.nodes[global(i)] = node;
+            top.costs[global(i)] = lin.costs[i];
+        }
+        lin = _BVHLinearNodes();
+    });
+    
+    // fit the top nodes, children first since they were created after their parents, then restructure them
+    for(int i = ntop-1; i >= 0; i --) {
+        auto& node = top.nodes[i];
+        if(node.leaf or node.n0 >= ntop) continue;
+        node.bbox = runion(top.nodes[node.n0].bbox, top.nodes[node.n1].bbox);
+        top.costs[i] = area(node.bbox) + top.costs[node.n0] + top.costs[node.n1];
+    }
+    for(int pass = 0; pass < bvh->treelet_passes; pass ++) intersect_lbvh_restructure_subtree(top, 0, ntop);
+    
+    bvh->nodes = std::move(top.nodes);
+    bvh->sorted_prims = std::move(ids);
+}
+
 void intersect_bvh_accelerate(BVHAccelerator* bvh)  {
+    if(bvh->linear) { intersect_lbvh_build(bvh); return; }
     vector<_BVHBoxedPrim> prims(bvh->_intersect_elem_num);
     for(auto i : range(prims.size())) {
         prims[i].i = i;
@@ -109,12 +505,59 @@ void intersect_bvh_accelerate(BVHAccelerator* bvh)  {
         prims[i].center = center(prims[i].bbox);
     }
     bvh->nodes.push_back(BVHNode());
+    if(bvh->spatial_splits) {
+        range3f bbox;
+        for(auto& p : prims) bbox = runion(bbox,p.bbox);
+        int budget = bvh->spatial_split_budget * bvh->_intersect_elem_num;
+        intersect_sbvh_build_node(bvh,0,prims,area(bbox),budget);
+        return;
+    }
     intersect_bvh_build_node(bvh,0,prims,0,prims.size());
     bvh->sorted_prims.resize(prims.size());
     for(auto i : range(prims.size())) bvh->sorted_prims[i] = prims[i].i;
 }
 
 range3f intersect_bvh_bounds(BVHAccelerator* bvh) {
-    return bvh->nodes[0].bbox;
+    return bvh->node(0).bbox;
 }
 
+
+float _intersect_bvh_volume(const range3f& bbox) {
+    if(not isvalid(bbox)) return 0;
+    auto d = size(bbox);
+    return d.x*d.y*d.z;
+}
+
+void intersect_bvhnode_stats(BVHAccelerator* bvh, int nodeid, int depth, float root_area, BVHStats& stats) {
+    auto& node = bvh->node(nodeid);
+    stats.nodes ++;
+    auto area_ratio = (root_area > 0) ? area(node.bbox) / root_area : 0;
+    if(node.leaf) {
+        auto n = node.end-node.start;
+        stats.leaves ++;
+        stats.sah_cost += area_ratio * n;
+        stats.max_depth = max(stats.max_depth, depth);
+        if(stats.depth_histogram.size() <= depth) stats.depth_histogram.resize(depth+1, 0);
+        stats.depth_histogram[depth] ++;
+        if(stats.leaf_histogram.size() <= n) stats.leaf_histogram.resize(n+1, 0);
+        stats.leaf_histogram[n] ++;
+    } else {
+        stats.sah_cost += area_ratio;
+        stats.overlap_volume += _intersect_bvh_volume(rintersect(bvh->node(node.n0).bbox, bvh->node(node.n1).bbox));
+        intersect_bvhnode_stats(bvh, node.n0, depth+1, root_area, stats);
+        intersect_bvhnode_stats(bvh, node.n1, depth+1, root_area, stats);
+    }
+}
+
+BVHStats intersect_bvh_stats(BVHAccelerator* bvh) {
+    auto stats = BVHStats();
+    stats.elements = bvh->_intersect_elem_num;
+    stats.bytes = bvh->nodes_num()*sizeof(BVHNode) + bvh->sorted_prims_num()*sizeof(int);
+    if(not bvh->nodes_num()) return stats;
+    intersect_bvhnode_stats(bvh, 0, 0, area(bvh->node(0).bbox), stats);
+    stats.empty_nodes = bvh->nodes_num() - stats.nodes;
+    stats.duplicated_refs = bvh->sorted_prims_num() - bvh->_intersect_elem_num;
+    auto root_volume = _intersect_bvh_volume(bvh->node(0).bbox);
+    stats.overlap_ratio = (root_volume > 0) ? stats.overlap_volume / root_volume : 0;
+    return stats;
+}
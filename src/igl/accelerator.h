@@ -24,15 +24,30 @@ struct BVHNode {
 struct BVHAccelerator {
     static const int                    min_prims = 4; ///< min primitives
     constexpr static const float        epsilon = ray3f::epsilon; ///< epsilon
+    static const int                    spatial_split_bins = 32; ///< bins per axis for spatial splits
+    constexpr static const float        spatial_split_alpha = 1e-5f; ///< min child overlap (relative to root area) to try spatial splits
+    
+    static const int                    treelet_leaves = 5; ///< leaves of the treelets restructured after linear builds
+    
+    bool                                spatial_splits = false; ///< build with spatial splits (SBVH)
+    float                               spatial_split_budget = 0.5f; ///< max duplicated references (relative to element number)
+    bool                                linear = false; ///< build in parallel from sorted Morton codes (LBVH), for per-frame rebuilds (spatial splits are ignored)
+    int                                 treelet_passes = 0; ///< treelet restructuring passes after linear builds, recovering SAH quality
     
     int                                                 _intersect_elem_num; ///< number of elements
     function<range3f (int)>                             _intersect_elem_bounds; ///< function for element bounds
+    function<range3f (int,const range3f&)>              _intersect_elem_clipped_bounds; ///< function for element bounds clipped to a box (optional, used by spatial splits)
     function<bool (int,const ray3f&,intersection3f&)>   _intersect_elem_first; ///< function for element first intersection
     function<bool (int,const ray3f&)>                   _intersect_elem_any; ///< function for element any intersection
     
     vector<int>                         sorted_prims; ///< sorted primitives
     vector<BVHNode>                     nodes; ///< bvh nodes
     
+    int                                 _mapped_nodes_num = 0; ///< number of external nodes
+    const BVHNode*                      _mapped_nodes = nullptr; ///< external (memory-mapped) nodes, used instead of nodes if set
+    int                                 _mapped_sorted_prims_num = 0; ///< number of external sorted primitives
+    const int*                          _mapped_sorted_prims = nullptr; ///< external (memory-mapped) sorted primitives, used instead of sorted_prims if set
+    
     /// Constructor (sets element number and functions)
     BVHAccelerator(int intersect_elem_num,
                    const function<range3f (int)> intersect_elem_bounds,
@@ -44,6 +59,31 @@ struct BVHAccelerator {
                     _intersect_elem_any(intersect_elem_any) { }
     /// Copy constructor
     BVHAccelerator(const BVHAccelerator& bvh) = default;    
+    
+    /// node access (external nodes if set)
+    const BVHNode& node(int i) const { return (_mapped_nodes) ? _mapped_nodes[i] : nodes[i]; }
+    /// number of nodes
+    int nodes_num() const { return (_mapped_nodes) ? _mapped_nodes_num : nodes.size(); }
+    /// sorted primitive access (external primitives if set)
+    int sorted_prim(int i) const { return (_mapped_sorted_prims) ? _mapped_sorted_prims[i] : sorted_prims[i]; }
+    /// number of sorted primitives
+    int sorted_prims_num() const { return (_mapped_sorted_prims) ? _mapped_sorted_prims_num : sorted_prims.size(); }
+};
+
+/// BVH quality statistics
+struct BVHStats {
+    int                 nodes = 0; ///< nodes reachable from the root
+    int                 leaves = 0; ///< leaf nodes
+    int                 empty_nodes = 0; ///< allocated nodes not reachable from the root
+    int                 elements = 0; ///< number of elements
+    int                 duplicated_refs = 0; ///< leaf references in excess of the elements (spatial splits)
+    int                 max_depth = 0; ///< max leaf depth
+    float               sah_cost = 0; ///< SAH cost with unit traversal and intersection costs
+    float               overlap_volume = 0; ///< sum of the sibling bounding box overlap volumes
+    float               overlap_ratio = 0; ///< overlap volume relative to the root volume
+    long                bytes = 0; ///< memory used by nodes and references
+    vector<int>         depth_histogram; ///< number of leaves at each depth
+    vector<int>         leaf_histogram; ///< number of leaves for each number of references
 };
 
 ///@name intersect interface
@@ -54,6 +94,11 @@ bool intersect_bvh_first(BVHAccelerator* bvh, const ray3f& ray, intersection3f&
 bool intersect_bvh_any(BVHAccelerator* bvh, const ray3f& ray);
 ///@}
 
+///@name analysis interface
+///@{
+BVHStats intersect_bvh_stats(BVHAccelerator* bvh);
+///@}
+
 ///@}
 
 #endif
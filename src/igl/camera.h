@@ -24,6 +24,15 @@ struct Camera : Node {
     float               pixel_scale = focus_dist / image_dist;
 };
 
+/// Camera views for batch rendering: the cameras as given, or views generated along them
+struct CameraPath : Node {
+    REGISTER_FAST_RTTI(Node,CameraPath,20)
+    
+    vector<Camera*>     cameras; ///< views (keyframes if views is set)
+    int                 views = 0; ///< number of views generated along the keyframes (cameras used as-is if zero)
+    bool                turntable = false; ///< generate views orbiting the first camera instead of interpolating keyframes
+};
+
 ///@name image size
 ///@{
 inline int camera_image_width(Camera* camera, int r) {
@@ -89,6 +98,17 @@ inline ray3f camera_ray(Camera* camera, const vec2f& uv, const vec2f& auv) {
     return transform_ray(camera->frame, rayl);
 }
 
+/// image coordinates of the point p (the inverse of camera_ray), false if p is behind the camera or off the image
+inline bool camera_project(Camera* camera, const vec3f& p, vec2f& uv) {
+    auto pl = transform_point_inverse(camera->frame, p);
+    if(not camera->orthographic) {
+        if(pl.z >= 0) return false;
+        pl = pl * (camera->image_dist / -pl.z);
+    }
+    uv = vec2f(pl.x / camera->image_width + 0.5f, pl.y / camera->image_height + 0.5f);
+    return uv.x >= 0 and uv.x < 1 and uv.y >= 0 and uv.y < 1;
+}
+
 inline ray3f camera_ray_dof(Camera* camera, const vec2f& uv, Rng& r) {
     ray3f rayl;
     // Disk domain
@@ -173,6 +193,58 @@ inline void camera_view_fps_rotate(Camera* camera, float delta_right, float delt
 }
 ///@}
 
+///@name camera paths
+///@{
+/// cameras orbiting the view center of camera around the world z axis (see camera_view_turntable_rotate)
+inline vector<Camera*> camera_path_turntable(Camera* camera, int views) {
+    auto cameras = vector<Camera*>();
+    for(int i = 0; i < views; i ++) {
+        auto view = new Camera(*camera);
+        camera_view_turntable_rotate(view, 2*pif*i/views, 0);
+        cameras.push_back(view);
+    }
+    return cameras;
+}
+
+/// cameras interpolating the keyframe cameras at evenly spaced views (first and last view at the end keyframes)
+inline vector<Camera*> camera_path_interpolate(const vector<Camera*>& keyframes, int views) {
+    auto cameras = vector<Camera*>();
+    for(int i = 0; i < views; i ++) {
+        auto t = (views > 1) ? (keyframes.size()-1) * i / float(views-1) : 0.0f;
+        auto k = clamp((int)t, 0, (int)keyframes.size()-2);
+        if(keyframes.size() == 1) { cameras.push_back(new Camera(*keyframes[0])); continue; }
+        auto c0 = keyframes[k], c1 = keyframes[k+1];
+        t -= k;
+        auto view = new Camera(*c0);
+        view->frame.o = interpolate_linear(c0->frame.o, c1->frame.o, t);
+        view->frame.x = interpolate_linear(c0->frame.x, c1->frame.x, t);
+        view->frame.y = interpolate_linear(c0->frame.y, c1->frame.y, t);
+        view->frame.z = interpolate_linear(c0->frame.z, c1->frame.z, t);
+        view->frame = orthonormalize(view->frame);
+        view->view_dist = interpolate_linear(c0->view_dist, c1->view_dist, t);
+        view->image_width = interpolate_linear(c0->image_width, c1->image_width, t);
+        view->image_height = interpolate_linear(c0->image_height, c1->image_height, t);
+        view->image_dist = interpolate_linear(c0->image_dist, c1->image_dist, t);
+        view->focus_dist = interpolate_linear(c0->focus_dist, c1->focus_dist, t);
+        view->focus_aperture = interpolate_linear(c0->focus_aperture, c1->focus_aperture, t);
+        cameras.push_back(view);
+    }
+    return cameras;
+}
+
+/// views of a camera path (newly allocated)
+inline vector<Camera*> camera_path_views(CameraPath* path) {
+    if(path->cameras.empty()) return vector<Camera*>();
+    if(not path->views) {
+        auto cameras = vector<Camera*>();
+        for(auto camera : path->cameras) cameras.push_back(new Camera(*camera));
+        return cameras;
+    }
+    if(path->turntable) return camera_path_turntable(path->cameras[0], path->views);
+    else return camera_path_interpolate(path->cameras, path->views);
+}
+///@}
+
 ///@}
 
 #endif
@@ -1,10 +1,17 @@
 #include "distraytrace.h"
+#include "raytrace.h"
 
 #include "vmath/random.h"
 #include "intersect.h"
+#include "photonmap.h"
 
 ///@file igl/distraytrace.cpp Distribution Raytracing. @ingroup igl
 
+// option flags resolved at compile time in the kernels below
+enum { _dist_raytrace_doublesided = 1, _dist_raytrace_shadows = 2, _dist_raytrace_reflections = 4, _dist_raytrace_cameralights = 8, _dist_raytrace_ambient_occlusion = 16,
+       _dist_raytrace_envlight_sh = 32, _dist_raytrace_caustics = 64 };
+
+template<int flags>
 vec3f _dist_raytrace_scene_ray(Scene* scene,
                                const ray3f& ray,
                                DistributionRaytraceOptions& opts,
@@ -23,14 +30,14 @@ vec3f _dist_raytrace_scene_ray(Scene* scene,
     auto& rng = opts.rng;
 
     // shading frame
-    if(opts.doublesided) frame = faceforward(frame, ray.d);
+    if(flags & _dist_raytrace_doublesided) frame = faceforward(frame, ray.d);
     frame = material_shading_frame(material, frame, texcoord);
 
     // brdf
     auto brdf = material_shading_textures(intersection.material, intersection.texcoord);
 
     // compute ambient
-    if (opts.samples_ambient != 0) {
+    if (flags & _dist_raytrace_ambient_occlusion) {
         int visible = 0;
         for (int i = 0; i < opts.samples_ambient; i++) {
             // Make random ray along hemisphere of intersection frame
@@ -56,8 +63,9 @@ vec3f _dist_raytrace_scene_ray(Scene* scene,
     c += material_emission(brdf, frame, wo);
     
     // compute direct
-    auto& ll = (opts.cameralights) ? scene->_cameralights : scene->lights;
+    auto& ll = (flags & _dist_raytrace_cameralights) ? scene->_cameralights : scene->lights;
     for(auto l : ll->lights) {
+        if((flags & _dist_raytrace_envlight_sh) and is<EnvLight>(l)) { c += raytrace_envlight_sh(scene, cast<EnvLight>(l), frame, brdf, flags & _dist_raytrace_shadows); continue; }
         auto ss = rand_light_shadow_sample(l, frame.o, rng.next_float(), rng.next_float());
         auto shadow_samples = (is<AreaLight>(l)) ? cast<AreaLight>(l)->shadow_samples : 1;
         for (int i = 0; i < shadow_samples; i++) {
@@ -65,7 +73,7 @@ vec3f _dist_raytrace_scene_ray(Scene* scene,
             if(ss.radiance == zero3f) continue;
             vec3f cl = ss.radiance * material_brdfcos(brdf,frame,wi,wo) / ss.pdf;
             if(cl == zero3f) continue;
-            if(opts.shadows) {
+            if(flags & _dist_raytrace_shadows) {
                 if(not intersect_scene_any( scene,ray3f::segment(frame.o,frame.o+ss.dir*ss.dist) )) {
                         c += cl / (float)shadow_samples;
 
@@ -78,12 +86,15 @@ vec3f _dist_raytrace_scene_ray(Scene* scene,
         }
     }
 
+    // compute caustics
+    if(flags & _dist_raytrace_caustics) c += photonmap_caustics_radiance(scene->_caustics, frame, wo, brdf);
+    
     // recursively compute reflections
-    if(opts.reflections and depth < opts.max_depth) {
+    if((flags & _dist_raytrace_reflections) and depth < opts.max_depth) {
         auto bs = material_sample_reflection(brdf, frame, wo);
         if(not (bs.brdfcos == zero3f)) {
             auto refl_ray = ray3f(frame.o,bs.wi);
-            c += _dist_raytrace_scene_ray(scene, refl_ray, opts, depth+1) * bs.brdfcos;
+            c += _dist_raytrace_scene_ray<flags>(scene, refl_ray, opts, depth+1) * bs.brdfcos;
 
         }
     }
@@ -96,24 +107,59 @@ vec3f _dist_raytrace_scene_ray(Scene* scene,
 
 }
 
+// kernel specializations, indexed by option flags
+using _dist_raytrace_kernel = vec3f (*)(Scene*, const ray3f&, DistributionRaytraceOptions&, int);
+template<int n>
+struct _dist_raytrace_kernel_table {
+    static void init(_dist_raytrace_kernel* kernels) { kernels[n-1] = _dist_raytrace_scene_ray<n-1>; _dist_raytrace_kernel_table<n-1>::init(kernels); }
+};
+template<>
+struct _dist_raytrace_kernel_table<0> {
+    static void init(_dist_raytrace_kernel* kernels) { }
+};
+struct _DistRaytraceKernels {
+    _dist_raytrace_kernel kernels[128];
+    _DistRaytraceKernels() { _dist_raytrace_kernel_table<128>::init(kernels); }
+};
+const _DistRaytraceKernels _dist_raytrace_kernels;
+
+// select the kernel matching the options and the scene
+_dist_raytrace_kernel _dist_raytrace_scene_kernel(Scene* scene, const DistributionRaytraceOptions& opts) {
+    return _dist_raytrace_kernels.kernels[((opts.doublesided) ? _dist_raytrace_doublesided : 0) | ((opts.shadows) ? _dist_raytrace_shadows : 0) |
+                                          ((opts.reflections) ? _dist_raytrace_reflections : 0) | ((opts.cameralights) ? _dist_raytrace_cameralights : 0) |
+                                          ((opts.samples_ambient != 0) ? _dist_raytrace_ambient_occlusion : 0) |
+                                          ((opts.envlight_sh) ? _dist_raytrace_envlight_sh : 0) | ((scene->_caustics) ? _dist_raytrace_caustics : 0)];
+}
+
 void dist_raytrace_scene_progressive(ImageBuffer& buffer,
                                      Scene* scene,
                                      DistributionRaytraceOptions& opts)
+{
+    dist_raytrace_scene_tile(buffer, scene, scene->camera, image_crop_tile(opts.crop,buffer.width(),buffer.height()), opts);
+}
+
+void dist_raytrace_scene_tile(ImageBuffer& buffer,
+                              Scene* scene,
+                              Camera* camera,
+                              const range2i& tile,
+                              DistributionRaytraceOptions& opts)
 {
     auto w = buffer.width();
     auto h = buffer.height();
     auto& rng = opts.rng;
+    auto kernel = _dist_raytrace_scene_kernel(scene, opts);
     
-    int s2 = max(1,(int)sqrt(opts.samples));
-    for(int j = 0; j < h; j ++) {
-        for(int i = 0; i < w; i ++) {
+    for(int j = tile.min.y; j < tile.max.y; j ++) {
+        for(int i = tile.min.x; i < tile.max.x; i ++) {
+            // pixels draw from their own sequence, so that crops and tilings match the full image
+            rng.seed(rng_seed_hash(j*w+i, buffer.samples.at(i,h-1-j)));
             // Monte Carlo anti-aliasing
             for (int k = 0; k < opts.samples; k++) { 
                 auto u = (i + (0.5f - rng.next_float())) / w;
                 auto v = (j + (0.5f - rng.next_float())) / h;
 
-                ray3f ray = camera_ray_dof(scene->camera, vec2f(u, v), rng); 
-                buffer.accum.at(i,h-1-j) += _dist_raytrace_scene_ray(scene,ray,opts,0);
+                ray3f ray = camera_ray_dof(camera, vec2f(u, v), rng); 
+                buffer.accum.at(i,h-1-j) += kernel(scene,ray,opts,0);
                 buffer.samples.at(i,h-1-j) += 1;
 
             }
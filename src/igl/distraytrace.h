@@ -28,13 +28,23 @@ struct DistributionRaytraceOptions : Node {
     
     bool shadows = true; ///< whether to compute shadows
     bool reflections = true; ///< whether to compute reflections
+    bool envlight_sh = false; ///< fast diffuse envlights: prefiltered irradiance and one visibility ray instead of shadow samples
     
     int max_depth = 4; ///< maximum ray recursion for reflections
     
+    range2i crop = range2i(); ///< pixels to render in image coordinates (x right, y down, max excluded; invalid for all)
+    
+    int caustics_photons = 0; ///< photons emitted for the caustic photon map (0: off)
+    float caustics_radius = 0.1f; ///< maximum caustic gather radius
+    int caustics_nearest = 50; ///< photons used for caustic density estimation
+    
     Rng rng; ///< random number generator
 };
 
+/// adds opts.samples samples to the pixels in opts.crop (all if not valid), with the same samples as a full render
 void dist_raytrace_scene_progressive(ImageBuffer& buffer, struct Scene* scene, DistributionRaytraceOptions& opts);
+/// adds opts.samples samples to the pixels of tile seen from camera (concurrent tiles need their own opts for the rng)
+void dist_raytrace_scene_tile(ImageBuffer& buffer, struct Scene* scene, Camera* camera, const range2i& tile, DistributionRaytraceOptions& opts);
 
 ///@}
 
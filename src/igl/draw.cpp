@@ -250,6 +250,35 @@ void draw_shape(Shape* shape) {
         }
         glEnd();
     }
+    else if(is<MappedMesh>(shape)) {
+        auto mesh = cast<MappedMesh>(shape);
+        vec2f triangleuv[3] = { {0,0}, {1,0}, {0,1} };
+        vec2f quaduv[4] = { {0,0}, {1,0}, {1,1}, {0,1} };
+        glBegin(GL_TRIANGLES);
+        for(int i = 0; i < mesh->_triangle_num; i ++) {
+            auto f = mesh->_triangle[i];
+            if(not mesh->_norm) glsNormal(triangle_normal(mesh->_pos[f.x],mesh->_pos[f.y],mesh->_pos[f.z]));
+            int uvcount = 0;
+            for(auto vid : f) {
+                if(mesh->_texcoord) glsTexCoord(mesh->_texcoord[vid]); else glsTexCoord(triangleuv[uvcount++]);
+                if(mesh->_norm) glsNormal(mesh->_norm[vid]);
+                glsVertex(mesh->_pos[vid]);
+            }
+        }
+        glEnd();
+        glBegin(GL_QUADS);
+        for(int i = 0; i < mesh->_quad_num; i ++) {
+            auto f = mesh->_quad[i];
+            if(not mesh->_norm) glsNormal(quad_normal(mesh->_pos[f.x],mesh->_pos[f.y],mesh->_pos[f.z],mesh->_pos[f.w]));
+            int uvcount = 0;
+            for(auto vid : f) {
+                if(mesh->_texcoord) glsTexCoord(mesh->_texcoord[vid]); else glsTexCoord(quaduv[uvcount++]);
+                if(mesh->_norm) glsNormal(mesh->_norm[vid]);
+                glsVertex(mesh->_pos[vid]);
+            }
+        }
+        glEnd();
+    }
     else if(is<Sphere>(shape)) glutils_draw_sphere(cast<Sphere>(shape)->center,cast<Sphere>(shape)->radius);
     else if(is<Cylinder>(shape)) glutils_draw_cylinder(cast<Cylinder>(shape)->radius,cast<Cylinder>(shape)->height);
     else if(is<Quad>(shape)) glutils_draw_quad(zero3f,x3f,y3f,cast<Quad>(shape)->width,cast<Quad>(shape)->height);
@@ -403,11 +432,11 @@ void draw_primitive(Primitive* prim, float time) {
     glPushAttrib(GL_TEXTURE_BIT);
     glsMultMatrix(frame_to_matrix(prim->frame));
     draw_material(prim->material);
-    if(is<Surface>(prim)) draw_shape(cast<Surface>(prim)->shape);
+    if(is<Surface>(prim)) draw_shape(surface_rendered_shape(cast<Surface>(prim)));
     else if(is<TransformedSurface>(prim)) {
         auto transformed = cast<TransformedSurface>(prim);
         glsMultMatrix(transformed_matrix(transformed, time));
-        draw_shape(transformed->shape);
+        draw_shape(transformed_rendered_shape(transformed));
     }
     else NOT_IMPLEMENTED_ERROR();
     glPopAttrib();
@@ -424,10 +453,10 @@ void draw_primitive_decorations(Primitive* prim, float time,
     glPushMatrix();
     glsMultMatrix(frame_to_matrix(prim->frame));
     if(colorscale >= 0) glsColor(material_display_color(prim->material)*colorscale);
-    if(is<Surface>(prim)) draw_shape_decorations(cast<Surface>(prim)->shape,edges,lines,control);
+    if(is<Surface>(prim)) draw_shape_decorations(surface_rendered_shape(cast<Surface>(prim)),edges,lines,control);
     else if(is<TransformedSurface>(prim)) {
         glsMultMatrix(transformed_matrix(cast<TransformedSurface>(prim), time));
-        draw_shape_decorations(cast<TransformedSurface>(prim)->shape,edges,lines,control);
+        draw_shape_decorations(transformed_rendered_shape(cast<TransformedSurface>(prim)),edges,lines,control);
     }
     else NOT_IMPLEMENTED_ERROR();
     glPopMatrix();
@@ -0,0 +1,140 @@
+#include "framebuffer.h"
+
+#include <cstring>
+#include <new>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+///@file igl/framebuffer.cpp Shared-memory framebuffers. @ingroup igl
+
+// segment layout: header, then accum (width*height vec3f) and samples (width*height int) in image order;
+// the sequence is shared by processes, so it has to be lock free
+struct _SharedFramebufferHeader {
+    char                    magic[8] = { 'I','G','L','F','B','U','F','1' };
+    std::atomic<unsigned>   sequence; ///< seqlock sequence, odd while publishing
+    int                     width = 0, height = 0;
+    int                     passes = 0, passes_total = 0, finished = 0;
+    long                    accum_offset = 0, samples_offset = 0;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared framebuffers need lock free atomics");
+
+const long _framebuffer_align = 64;
+
+long _framebuffer_aligned(long offset) { return (offset + _framebuffer_align - 1) / _framebuffer_align * _framebuffer_align; }
+
+#ifndef _WIN32
+
+SharedFramebuffer* framebuffer_create(const string& name, int w, int h, int passes_total) {
+    auto accum_offset = _framebuffer_aligned(sizeof(_SharedFramebufferHeader));
+    auto samples_offset = _framebuffer_aligned(accum_offset + w*h*sizeof(vec3f));
+    auto size = samples_offset + w*h*sizeof(int);
+
+    // replace stale segments, e.g. left by a render that crashed, since their size may differ
+    shm_unlink(name.c_str());
+    auto fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    ERROR_IF_NOT(fd >= 0, "cannot create shared memory %s", name.c_str());
+    ERROR_IF_NOT(ftruncate(fd, size) == 0, "cannot size shared memory %s", name.c_str());
+    auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ERROR_IF_NOT(data != MAP_FAILED, "cannot map shared memory %s", name.c_str());
+
+    // the segment is zero filled, so readers see no samples until the first publish
+    auto header = new (data) _SharedFramebufferHeader();
+    header->sequence.store(0);
+    header->width = w;
+    header->height = h;
+    header->passes_total = passes_total;
+    header->accum_offset = accum_offset;
+    header->samples_offset = samples_offset;
+
+    auto fb = new SharedFramebuffer();
+    fb->name = name;
+    fb->_owner = true;
+    fb->_data = data;
+    fb->_size = size;
+    return fb;
+}
+
+void framebuffer_publish(SharedFramebuffer* fb, const ImageBuffer& buffer, int passes, bool finished) {
+    auto header = (_SharedFramebufferHeader*)fb->_data;
+    auto bytes = (char*)fb->_data;
+    ERROR_IF_NOT(buffer.width() == header->width and buffer.height() == header->height, "buffer should be %dx%d", header->width, header->height);
+    auto sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->passes = passes;
+    header->finished = finished;
+    memcpy(bytes + header->accum_offset, buffer.accum.data(), header->width*header->height*sizeof(vec3f));
+    memcpy(bytes + header->samples_offset, buffer.samples.data(), header->width*header->height*sizeof(int));
+    header->sequence.store(sequence+2, std::memory_order_release);
+}
+
+SharedFramebuffer* framebuffer_open(const string& name) {
+    auto fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0) return nullptr;
+    struct stat st;
+    fstat(fd, &st);
+    auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ERROR_IF_NOT(data != MAP_FAILED, "cannot map shared memory %s", name.c_str());
+
+    auto header = (const _SharedFramebufferHeader*)data;
+    ERROR_IF_NOT(st.st_size >= sizeof(_SharedFramebufferHeader) and not strncmp(header->magic, _SharedFramebufferHeader().magic, 8) and
+                 st.st_size >= header->samples_offset + header->width*header->height*sizeof(int),
+                 "unknown shared memory format %s", name.c_str());
+    auto fb = new SharedFramebuffer();
+    fb->name = name;
+    fb->_data = data;
+    fb->_size = st.st_size;
+    return fb;
+}
+
+unsigned framebuffer_sequence(SharedFramebuffer* fb) {
+    return ((_SharedFramebufferHeader*)fb->_data)->sequence.load(std::memory_order_acquire);
+}
+
+SharedFrame framebuffer_read(SharedFramebuffer* fb) {
+    auto header = (_SharedFramebufferHeader*)fb->_data;
+    auto bytes = (const char*)fb->_data;
+    auto frame = SharedFrame();
+    frame.buffer = ImageBuffer(header->width, header->height);
+    while(true) {
+        auto sequence = header->sequence.load(std::memory_order_acquire);
+        if(sequence % 2) { std::this_thread::yield(); continue; }
+        frame.passes = header->passes;
+        frame.passes_total = header->passes_total;
+        frame.finished = header->finished;
+        memcpy(frame.buffer.accum.data(), bytes + header->accum_offset, header->width*header->height*sizeof(vec3f));
+        memcpy(frame.buffer.samples.data(), bytes + header->samples_offset, header->width*header->height*sizeof(int));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(header->sequence.load(std::memory_order_relaxed) == sequence) { frame.sequence = sequence; return frame; }
+    }
+}
+
+void framebuffer_close(SharedFramebuffer* fb) {
+    munmap(fb->_data, fb->_size);
+    delete fb;
+}
+
+void framebuffer_remove(const string& name) {
+    shm_unlink(name.c_str());
+}
+
+#else
+
+SharedFramebuffer* framebuffer_create(const string& name, int w, int h, int passes_total) { NOT_IMPLEMENTED_ERROR(); return nullptr; }
+void framebuffer_publish(SharedFramebuffer* fb, const ImageBuffer& buffer, int passes, bool finished) { NOT_IMPLEMENTED_ERROR(); }
+SharedFramebuffer* framebuffer_open(const string& name) { NOT_IMPLEMENTED_ERROR(); return nullptr; }
+unsigned framebuffer_sequence(SharedFramebuffer* fb) { NOT_IMPLEMENTED_ERROR(); return 0; }
+SharedFrame framebuffer_read(SharedFramebuffer* fb) { NOT_IMPLEMENTED_ERROR(); return SharedFrame(); }
+void framebuffer_close(SharedFramebuffer* fb) { NOT_IMPLEMENTED_ERROR(); }
+void framebuffer_remove(const string& name) { NOT_IMPLEMENTED_ERROR(); }
+
+#endif
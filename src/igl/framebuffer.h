@@ -0,0 +1,52 @@
+#ifndef _FRAMEBUFFER_H_
+#define _FRAMEBUFFER_H_
+
+#include "image.h"
+
+///@file igl/framebuffer.h Shared-memory framebuffers. @ingroup igl
+///@defgroup framebuffer Shared-memory framebuffers
+///@ingroup igl
+///@{
+
+/// Image buffer published in a POSIX shared-memory segment, so that other processes can follow a render
+/// without file I/O: a header (size, passes, seqlock sequence) followed by the accum and samples arrays.
+/// The renderer copies its buffer in after every pass, bumping the sequence to odd before and to even after,
+/// so readers copying out can tell torn frames and retry. The segment outlives the render, so readers can
+/// map it at any time, until the next render with the same name replaces it or it is removed.
+struct SharedFramebuffer {
+    string      name; ///< shared memory name (starting with /)
+    bool        _owner = false; ///< whether this process created the segment
+    void*       _data = nullptr; ///< mapped segment
+    size_t      _size = 0; ///< mapped size
+};
+
+/// Consistent frame read from a shared framebuffer
+struct SharedFrame {
+    int             passes = 0; ///< passes accumulated
+    int             passes_total = 0; ///< passes the render will accumulate
+    bool            finished = false; ///< whether the render is done
+    unsigned        sequence = 0; ///< seqlock sequence of the frame (changes with every publish)
+    ImageBuffer     buffer; ///< accumulated color and samples
+};
+
+///@name shared framebuffer interface
+///@{
+/// creates (or replaces) the segment name for w x h images
+SharedFramebuffer* framebuffer_create(const string& name, int w, int h, int passes_total);
+/// copies buffer into the segment, after passes of passes_total
+void framebuffer_publish(SharedFramebuffer* fb, const ImageBuffer& buffer, int passes, bool finished);
+/// maps an existing segment for reading (nullptr if it does not exist)
+SharedFramebuffer* framebuffer_open(const string& name);
+/// sequence of the last published frame (odd while a frame is being published)
+unsigned framebuffer_sequence(SharedFramebuffer* fb);
+/// reads a consistent frame, retrying while the renderer is publishing
+SharedFrame framebuffer_read(SharedFramebuffer* fb);
+/// unmaps the segment, leaving it in place for readers
+void framebuffer_close(SharedFramebuffer* fb);
+/// removes the segment name (mapped readers keep their copy until they close)
+void framebuffer_remove(const string& name);
+///@}
+
+///@}
+
+#endif
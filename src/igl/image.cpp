@@ -212,6 +212,28 @@ void imageio_write_png16(const string& filename, const image<vec3f>& img, bool f
     if(error) { WARNING("cannot write png image: %s", filename.c_str()); }
 }
 
+ImageErrors image_errors(const image<vec3f>& ref, const image<vec3f>& img) {
+    ERROR_IF_NOT(ref.width() == img.width() and ref.height() == img.height(), "images should be same size");
+    auto errors = ImageErrors();
+    auto n = ref.width()*ref.height()*3;
+    if(not n) return errors;
+    auto se = 0.0, rse = 0.0, ref_lum = 0.0, img_lum = 0.0;
+    for(auto i : range(ref.width()*ref.height())) {
+        ref_lum += 0.2126*ref.data()[i].x + 0.7152*ref.data()[i].y + 0.0722*ref.data()[i].z;
+        img_lum += 0.2126*img.data()[i].x + 0.7152*img.data()[i].y + 0.0722*img.data()[i].z;
+        for(auto c : range(3)) {
+            auto r = (double)ref.data()[i][c], d = img.data()[i][c] - r;
+            se += d*d;
+            rse += d*d / (r*r + ImageErrors::relmse_epsilon);
+        }
+    }
+    errors.rmse = sqrt(se / n);
+    errors.relmse = rse / n;
+    errors.psnr = -10*log10(max(se / n, 1e-20));
+    errors.bias = (ref_lum > 0) ? img_lum / ref_lum - 1 : 0;
+    return errors;
+}
+
 void imageio_write_auto(const string& filename, const image<vec3f>& img, bool flipY) {
     if(string_endswith(filename, "png")) imageio_write_png(filename, img, flipY);
     else if(string_endswith(filename, "pfm")) imageio_write_pfm(filename, img, flipY);
@@ -67,19 +67,29 @@ struct ImageBuffer {
     int width() const { return accum.width(); }
     int height() const { return accum.height(); }
     
+    /// average color of the pixels, black for pixels with no samples (e.g. outside a crop)
     void get_image(image<vec3f>& img, float gamma=1.0f) {
         auto w = width();
         auto h = height();
         img = image<vec3f>(w,h);
         for(int j = 0; j < h; j ++) {
             for(int i = 0; i < w; i ++) {
-                img.at(i,h-1-j) = pow(accum.at(i,h-1-j) / samples.at(i,h-1-j), gamma);
+                auto s = samples.at(i,h-1-j);
+                img.at(i,h-1-j) = (s) ? pow(accum.at(i,h-1-j) / s, gamma) : zero3f;
             }
         }
     }
 };
 
 
+/// tile of the pixels of a w x h image within crop, given in image coordinates (x right, y down, max excluded),
+/// in the bottom-up rows renderers loop over; the whole image if crop is not valid
+inline range2i image_crop_tile(const range2i& crop, int w, int h) {
+    auto full = range2i(zero2i,vec2i(w,h));
+    if(not isvalid(crop)) return full;
+    return rintersect(full, range2i(vec2i(crop.min.x,h-crop.max.y),vec2i(crop.max.x,h-crop.min.y)));
+}
+
 ///@name image typedefs
 ///@{
 typedef image<vec3f> image3f;
@@ -130,6 +140,22 @@ inline image<T> flipy(const image<T>& img) {
 }
 ///@}
 
+/// errors of an image against a reference, over pixels and channels
+struct ImageErrors {
+    float   rmse = 0; ///< root mean squared error
+    float   relmse = 0; ///< mean squared error relative to the squared reference (plus relmse_epsilon), so dark regions count as much as bright ones
+    float   psnr = 0; ///< peak signal to noise ratio in dB, with a peak of 1 (200 for equal images)
+    float   bias = 0; ///< relative difference of mean luminance (Rec. 709), positive if brighter than the reference
+    
+    constexpr static const float relmse_epsilon = 1e-2f; ///< added to the squared reference to keep relmse finite
+};
+
+///@name image metrics
+///@{
+/// errors of img against ref (images should be same size)
+ImageErrors image_errors(const image<vec3f>& ref, const image<vec3f>& img);
+///@}
+
 ///@name image io
 ///@{
 void imageio_write_pfm(const string& filename, const image<vec3f>& img, bool flipY = false);
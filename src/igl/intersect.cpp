@@ -10,6 +10,7 @@ bool intersect_pointset_element_first(PointSet* pointset, int elementid, const r
         if(not intersect_point_approximate(ray, pointset->pos[elementid], pointset->radius[elementid], t)) return false;
         
         intersection.ray_t = t;
+        intersection.element_id = elementid;
         intersection.uv = zero2f;
         
         intersection.frame.o = ray.eval(t);
@@ -26,6 +27,7 @@ bool intersect_pointset_element_first(PointSet* pointset, int elementid, const r
         if(not intersect_sphere(ray, pointset->pos[elementid], pointset->radius[elementid], t)) return false;
         
         intersection.ray_t = t;
+        intersection.element_id = elementid;
         auto pl = (ray.eval(t) - pointset->pos[elementid]) / pointset->radius[elementid];
         intersection.uv = vec2f(atan2pos(pl.y,pl.x)/(2*pi),acos(pl.z)/pi);
         
@@ -45,6 +47,7 @@ bool intersect_lineset_element_first(LineSet* lines, int elementid, const ray3f&
         if(not intersect_line_approximate(ray, lines->pos[l.x], lines->pos[l.y], lines->radius[l.x], lines->radius[l.y], t, s)) return false;
         
         intersection.ray_t = t;        
+        intersection.element_id = elementid;
         intersection.uv = vec2f(s,0);
         
         intersection.frame.o = ray.eval(t);
@@ -68,6 +71,7 @@ bool intersect_lineset_element_first(LineSet* lines, int elementid, const ray3f&
         if(not intersect_cylinder(tray, r, h, t)) return false;
         
         intersection.ray_t = t;
+        intersection.element_id = elementid;
         
         auto pl = tray.eval(t) / vec3f(r,r,h);
         intersection.uv = vec2f(atan2pos(pl.y,pl.x)/(2*pi),pl.z);
@@ -87,6 +91,7 @@ bool intersect_trianglemesh_element_first(TriangleMesh* mesh, int elementid, con
     if(not hit) return false;
     
     intersection.ray_t = t;
+    intersection.element_id = elementid;
     intersection.uv = uv;
     
     intersection.frame = trianglemesh_frame(mesh, elementid, intersection.uv);
@@ -95,14 +100,25 @@ bool intersect_trianglemesh_element_first(TriangleMesh* mesh, int elementid, con
     return true;
 }
 
+// Mesh and FaceMesh elements are triangles followed by whole quads, tested as their two triangles at once;
+// element_id and uv are reported for the hit triangle as in mesh_triangle_face
 bool intersect_mesh_element_first(Mesh* mesh, int elementid, const ray3f& ray, intersection3f& intersection) {
-    auto f = mesh_triangle_face(mesh,elementid);
-
     float t; vec2f uv;
-    bool hit = intersect_triangle(ray, mesh->pos[f.x], mesh->pos[f.y], mesh->pos[f.z], t, uv.x, uv.y);
-    if(not hit) return false;
+    if(elementid >= mesh->triangle.size()) {
+        auto q = mesh->quad[elementid-mesh->triangle.size()];
+        int half;
+        bool hit = intersect_quad_triangles(ray, mesh->pos[q.x], mesh->pos[q.y], mesh->pos[q.z], mesh->pos[q.w], t, uv.x, uv.y, half);
+        if(not hit) return false;
+        elementid = mesh->triangle.size() + (elementid-mesh->triangle.size())*2 + half;
+    } else {
+        auto f = mesh->triangle[elementid];
+        bool hit = intersect_triangle(ray, mesh->pos[f.x], mesh->pos[f.y], mesh->pos[f.z], t, uv.x, uv.y);
+        if(not hit) return false;
+    }
+    auto f = mesh_triangle_face(mesh,elementid);
     
     intersection.ray_t = t;
+    intersection.element_id = elementid;
     intersection.uv = uv;
     
     intersection.frame = mesh_frame(mesh, elementid, intersection.uv);
@@ -111,18 +127,58 @@ bool intersect_mesh_element_first(Mesh* mesh, int elementid, const ray3f& ray, i
     return true;        
 }
 
+// FaceMesh element positions, read from the flattened copy built by intersect_shape_accelerate when present
+// (avoiding the vertex indirection during traversal) and gathered through the indices otherwise
+inline const vec3f* _intersect_facemesh_element_pos(FaceMesh* mesh, int elementid, vec3f* buf) {
+    if(not mesh->_intersect_pos.empty()) return mesh->_intersect_pos.data() + elementid*4;
+    auto f = (elementid >= mesh->triangle.size()) ? mesh->quad[elementid-mesh->triangle.size()] : vec4i(mesh->triangle[elementid].x,mesh->triangle[elementid].y,mesh->triangle[elementid].z,mesh->triangle[elementid].z);
+    for(int i = 0; i < 4; i ++) buf[i] = mesh->pos[mesh->vertex[f[i]].x];
+    return buf;
+}
+
 bool intersect_facemesh_element_first(FaceMesh* mesh, int elementid, const ray3f& ray, intersection3f& intersection) {
-    auto f = facemesh_triangle_face(mesh,elementid);
+    vec3f buf[4]; auto v = _intersect_facemesh_element_pos(mesh,elementid,buf);
+    float t; vec2f uv; int half = 0;
+    if(elementid >= mesh->triangle.size()) {
+        bool hit = intersect_quad_triangles(ray, v[0], v[1], v[2], v[3], t, uv.x, uv.y, half);
+        if(not hit) return false;
+        elementid = mesh->triangle.size() + (elementid-mesh->triangle.size())*2 + half;
+    } else {
+        bool hit = intersect_triangle(ray, v[0], v[1], v[2], t, uv.x, uv.y);
+        if(not hit) return false;
+    }
+    
+    intersection.ray_t = t;
+    intersection.element_id = elementid;
+    intersection.uv = uv;
     
+    intersection.frame = facemesh_frame(mesh, elementid, intersection.uv);
+    intersection.geom_norm = (half) ? triangle_normal(v[0],v[2],v[3]) : triangle_normal(v[0],v[1],v[2]);
+    
+    return true;
+}
+
+bool intersect_mappedmesh_element_first(MappedMesh* mesh, int elementid, const ray3f& ray, intersection3f& intersection) {
     float t; vec2f uv;
-    bool hit = intersect_triangle(ray, mesh->pos[mesh->vertex[f.x].x], mesh->pos[mesh->vertex[f.y].x], mesh->pos[mesh->vertex[f.z].x], t, uv.x, uv.y);
-    if(not hit) return false;
+    if(elementid >= mesh->_triangle_num) {
+        auto q = mesh->_quad[elementid-mesh->_triangle_num];
+        int half;
+        bool hit = intersect_quad_triangles(ray, mesh->_pos[q.x], mesh->_pos[q.y], mesh->_pos[q.z], mesh->_pos[q.w], t, uv.x, uv.y, half);
+        if(not hit) return false;
+        elementid = mesh->_triangle_num + (elementid-mesh->_triangle_num)*2 + half;
+    } else {
+        auto f = mesh->_triangle[elementid];
+        bool hit = intersect_triangle(ray, mesh->_pos[f.x], mesh->_pos[f.y], mesh->_pos[f.z], t, uv.x, uv.y);
+        if(not hit) return false;
+    }
+    auto f = mappedmesh_triangle_face(mesh,elementid);
     
     intersection.ray_t = t;
+    intersection.element_id = elementid;
     intersection.uv = uv;
     
-    intersection.frame = facemesh_frame(mesh, elementid, intersection.uv);
-    intersection.geom_norm = triangle_normal(mesh->pos[mesh->vertex[f.x].x],mesh->pos[mesh->vertex[f.y].x],mesh->pos[mesh->vertex[f.z].x]);
+    intersection.frame = mappedmesh_frame(mesh, elementid, intersection.uv);
+    intersection.geom_norm = triangle_normal(mesh->_pos[f.x],mesh->_pos[f.y],mesh->_pos[f.z]);
     
     return true;
 }
@@ -147,13 +203,27 @@ bool intersect_trianglemesh_element_any(TriangleMesh* mesh, int elementid, const
 }
 
 bool intersect_mesh_element_any(Mesh* mesh, int elementid, const ray3f& ray) {
-    auto f = mesh_triangle_face(mesh,elementid);
+    if(elementid >= mesh->triangle.size()) {
+        auto q = mesh->quad[elementid-mesh->triangle.size()];
+        return intersect_quad_triangles(ray, mesh->pos[q.x], mesh->pos[q.y], mesh->pos[q.z], mesh->pos[q.w]);
+    }
+    auto f = mesh->triangle[elementid];
     return intersect_triangle(ray, mesh->pos[f.x], mesh->pos[f.y], mesh->pos[f.z]);
 }
 
 bool intersect_facemesh_element_any(FaceMesh* mesh, int elementid, const ray3f& ray) {
-    auto f = facemesh_triangle_face(mesh,elementid);
-    return intersect_triangle(ray, mesh->pos[mesh->vertex[f.x].x], mesh->pos[mesh->vertex[f.y].x], mesh->pos[mesh->vertex[f.z].x]);
+    vec3f buf[4]; auto v = _intersect_facemesh_element_pos(mesh,elementid,buf);
+    if(elementid >= mesh->triangle.size()) return intersect_quad_triangles(ray, v[0], v[1], v[2], v[3]);
+    return intersect_triangle(ray, v[0], v[1], v[2]);
+}
+
+bool intersect_mappedmesh_element_any(MappedMesh* mesh, int elementid, const ray3f& ray) {
+    if(elementid >= mesh->_triangle_num) {
+        auto q = mesh->_quad[elementid-mesh->_triangle_num];
+        return intersect_quad_triangles(ray, mesh->_pos[q.x], mesh->_pos[q.y], mesh->_pos[q.z], mesh->_pos[q.w]);
+    }
+    auto f = mesh->_triangle[elementid];
+    return intersect_triangle(ray, mesh->_pos[f.x], mesh->_pos[f.y], mesh->_pos[f.z]);
 }
 
 range3f intersect_pointset_element_bounds(PointSet* pointset, int elementid) {
@@ -175,13 +245,46 @@ range3f intersect_trianglemesh_element_bounds(TriangleMesh* mesh, int elementid)
 }
 
 range3f intersect_mesh_element_bounds(Mesh* mesh, int elementid) {
-    auto f = mesh_triangle_face(mesh,elementid);
+    if(elementid >= mesh->triangle.size()) {
+        auto q = mesh->quad[elementid-mesh->triangle.size()];
+        return quad_bounds(mesh->pos[q.x], mesh->pos[q.y], mesh->pos[q.z], mesh->pos[q.w]);
+    }
+    auto f = mesh->triangle[elementid];
     return triangle_bounds(mesh->pos[f.x], mesh->pos[f.y], mesh->pos[f.z]);
 }
 
 range3f intersect_facemesh_element_bounds(FaceMesh* mesh, int elementid) {
-    auto f = facemesh_triangle_face(mesh,elementid);
-    return triangle_bounds(mesh->pos[mesh->vertex[f.x].x], mesh->pos[mesh->vertex[f.y].x], mesh->pos[mesh->vertex[f.z].x]);
+    vec3f buf[4]; auto v = _intersect_facemesh_element_pos(mesh,elementid,buf);
+    return quad_bounds(v[0], v[1], v[2], v[3]);
+}
+
+range3f intersect_mappedmesh_element_bounds(MappedMesh* mesh, int elementid) {
+    if(elementid >= mesh->_triangle_num) {
+        auto q = mesh->_quad[elementid-mesh->_triangle_num];
+        return quad_bounds(mesh->_pos[q.x], mesh->_pos[q.y], mesh->_pos[q.z], mesh->_pos[q.w]);
+    }
+    auto f = mesh->_triangle[elementid];
+    return triangle_bounds(mesh->_pos[f.x], mesh->_pos[f.y], mesh->_pos[f.z]);
+}
+
+range3f intersect_trianglemesh_element_clipped_bounds(TriangleMesh* mesh, int elementid, const range3f& bbox) {
+    auto f = mesh->triangle[elementid];
+    return triangle_clipped_bounds(mesh->pos[f.x], mesh->pos[f.y], mesh->pos[f.z], bbox);
+}
+
+range3f intersect_mesh_element_clipped_bounds(Mesh* mesh, int elementid, const range3f& bbox) {
+    if(elementid >= mesh->triangle.size()) {
+        auto q = mesh->quad[elementid-mesh->triangle.size()];
+        return quad_clipped_bounds(mesh->pos[q.x], mesh->pos[q.y], mesh->pos[q.z], mesh->pos[q.w], bbox);
+    }
+    auto f = mesh->triangle[elementid];
+    return triangle_clipped_bounds(mesh->pos[f.x], mesh->pos[f.y], mesh->pos[f.z], bbox);
+}
+
+range3f intersect_facemesh_element_clipped_bounds(FaceMesh* mesh, int elementid, const range3f& bbox) {
+    vec3f buf[4]; auto v = _intersect_facemesh_element_pos(mesh,elementid,buf);
+    if(elementid >= mesh->triangle.size()) return quad_clipped_bounds(v[0], v[1], v[2], v[3], bbox);
+    return triangle_clipped_bounds(v[0], v[1], v[2], bbox);
 }
 
 range3f intersect_shape_bounds(Shape* shape) {
@@ -209,13 +312,33 @@ range3f intersect_shape_bounds(Shape* shape) {
     else if(is<FaceMesh>(shape)) {
         return range_from_values(cast<FaceMesh>(shape)->pos);
     }
+    else if(is<MappedMesh>(shape)) {
+        return range_from_values(cast<MappedMesh>(shape)->_pos, cast<MappedMesh>(shape)->_pos_num);
+    }
     else if(is<Sphere>(shape)) return sphere_bounds(cast<Sphere>(shape)->center, cast<Sphere>(shape)->radius);
     else if(is<Cylinder>(shape)) return cylinder_bounds(cast<Cylinder>(shape)->radius, cast<Cylinder>(shape)->height);
     else if(is<Quad>(shape)) return quad_bounds(cast<Quad>(shape)->width,cast<Quad>(shape)->height);
     else if(is<Triangle>(shape)) return triangle_bounds(cast<Triangle>(shape)->v0, cast<Triangle>(shape)->v1, cast<Triangle>(shape)->v2);
+    else if(is<DisplacedShape>(shape)) {
+        // conservative: vertices move along unit normals by at most height times the largest texel
+        auto displaced = cast<DisplacedShape>(shape);
+        auto bbox = intersect_shape_bounds(displaced->shape);
+        auto d = 0.0f;
+        if(displaced->displacement) for(auto& texel : displaced->displacement->image) d = max(d,abs(mean_component(texel)));
+        d *= abs(displaced->height);
+        return range3f(bbox.min-vec3f(d,d,d),bbox.max+vec3f(d,d,d));
+    }
     else { NOT_IMPLEMENTED_ERROR(); return range3f(); }
 }
 
+// copy FaceMesh element positions to _intersect_pos, four per element with triangles repeating their last vertex
+void _intersect_facemesh_flatten(FaceMesh* mesh) {
+    mesh->_intersect_pos.clear();
+    mesh->_intersect_pos.reserve((mesh->triangle.size()+mesh->quad.size())*4);
+    for(auto f : mesh->triangle) for(auto vid : vec4i(f.x,f.y,f.z,f.z)) mesh->_intersect_pos.push_back(mesh->pos[mesh->vertex[vid].x]);
+    for(auto f : mesh->quad) for(auto vid : f) mesh->_intersect_pos.push_back(mesh->pos[mesh->vertex[vid].x]);
+}
+
 void intersect_shape_accelerate(Shape* shape) {
     if(not shape->intersect_accelerator_use) return;
     if(shape->_intersect_accelerator) {
@@ -224,7 +347,12 @@ void intersect_shape_accelerate(Shape* shape) {
         shape->_intersect_accelerator = nullptr;
     }
     
-    if(shape->_tesselation) return intersect_shape_accelerate(shape->_tesselation);
+    if(shape->_tesselation) {
+        shape->_tesselation->intersect_accelerator_spatial_splits = shape->intersect_accelerator_spatial_splits;
+        shape->_tesselation->intersect_accelerator_linear = shape->intersect_accelerator_linear;
+        shape->_tesselation->intersect_accelerator_treelet_passes = shape->intersect_accelerator_treelet_passes;
+        return intersect_shape_accelerate(shape->_tesselation);
+    }
 
     if(is<PointSet>(shape)) {
         auto pointset = cast<PointSet>(shape);
@@ -234,6 +362,8 @@ void intersect_shape_accelerate(Shape* shape) {
                                [pointset](int elementid){return intersect_pointset_element_bounds(pointset,elementid);},
                                [pointset](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_pointset_element_first(pointset,elementid,ray,intersection); },
                                [pointset](int elementid, const ray3f& ray){ return intersect_pointset_element_any(pointset,elementid,ray); });
+        shape->_intersect_accelerator->linear = shape->intersect_accelerator_linear;
+        shape->_intersect_accelerator->treelet_passes = shape->intersect_accelerator_treelet_passes;
         intersect_bvh_accelerate(shape->_intersect_accelerator);
     } else if(is<LineSet>(shape)) {
         auto lines = cast<LineSet>(shape);
@@ -243,7 +373,9 @@ void intersect_shape_accelerate(Shape* shape) {
                                [lines](int elementid){return intersect_lineset_element_bounds(lines,elementid);},
                                [lines](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_lineset_element_first(lines,elementid,ray,intersection); },
                                [lines](int elementid, const ray3f& ray){ return intersect_lineset_element_any(lines,elementid,ray); });
-            intersect_bvh_accelerate(shape->_intersect_accelerator);
+        shape->_intersect_accelerator->linear = shape->intersect_accelerator_linear;
+        shape->_intersect_accelerator->treelet_passes = shape->intersect_accelerator_treelet_passes;
+        intersect_bvh_accelerate(shape->_intersect_accelerator);
     } else if(is<TriangleMesh>(shape)) {
         auto mesh = cast<TriangleMesh>(shape);
         if(BVHAccelerator::min_prims > mesh->triangle.size()) return;
@@ -252,25 +384,58 @@ void intersect_shape_accelerate(Shape* shape) {
                                [mesh](int elementid){return intersect_trianglemesh_element_bounds(mesh,elementid);},
                                [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_trianglemesh_element_first(mesh,elementid,ray,intersection); },
                                [mesh](int elementid, const ray3f& ray){ return intersect_trianglemesh_element_any(mesh,elementid,ray); });
+        mesh->_intersect_accelerator->spatial_splits = mesh->intersect_accelerator_spatial_splits;
+        mesh->_intersect_accelerator->_intersect_elem_clipped_bounds = [mesh](int elementid, const range3f& bbox){ return intersect_trianglemesh_element_clipped_bounds(mesh,elementid,bbox); };
+        shape->_intersect_accelerator->linear = shape->intersect_accelerator_linear;
+        shape->_intersect_accelerator->treelet_passes = shape->intersect_accelerator_treelet_passes;
         intersect_bvh_accelerate(shape->_intersect_accelerator);
     } else if(is<Mesh>(shape)) {
         auto mesh = cast<Mesh>(shape);
-        if(BVHAccelerator::min_prims > mesh->triangle.size() + mesh->quad.size()*2) return;
+        if(BVHAccelerator::min_prims > mesh->triangle.size() + mesh->quad.size()) return;
         mesh->_intersect_accelerator =
-        new BVHAccelerator(mesh->triangle.size() + mesh->quad.size()*2,
+        new BVHAccelerator(mesh->triangle.size() + mesh->quad.size(),
                            [mesh](int elementid){return intersect_mesh_element_bounds(mesh,elementid);},
                            [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_mesh_element_first(mesh,elementid,ray,intersection); },
                            [mesh](int elementid, const ray3f& ray){ return intersect_mesh_element_any(mesh,elementid,ray); });
+        mesh->_intersect_accelerator->spatial_splits = mesh->intersect_accelerator_spatial_splits;
+        mesh->_intersect_accelerator->_intersect_elem_clipped_bounds = [mesh](int elementid, const range3f& bbox){ return intersect_mesh_element_clipped_bounds(mesh,elementid,bbox); };
+        shape->_intersect_accelerator->linear = shape->intersect_accelerator_linear;
+        shape->_intersect_accelerator->treelet_passes = shape->intersect_accelerator_treelet_passes;
         intersect_bvh_accelerate(shape->_intersect_accelerator);
     } else if(is<FaceMesh>(shape)) {
         auto mesh = cast<FaceMesh>(shape);
+        _intersect_facemesh_flatten(mesh);
         if(BVHAccelerator::min_prims > mesh->triangle.size() + mesh->quad.size()) return;
         mesh->_intersect_accelerator =
-        new BVHAccelerator(mesh->triangle.size() + mesh->quad.size()*2,
+        new BVHAccelerator(mesh->triangle.size() + mesh->quad.size(),
                            [mesh](int elementid){return intersect_facemesh_element_bounds(mesh,elementid);},
                            [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_facemesh_element_first(mesh,elementid,ray,intersection); },
                            [mesh](int elementid, const ray3f& ray){ return intersect_facemesh_element_any(mesh,elementid,ray); });
+        mesh->_intersect_accelerator->spatial_splits = mesh->intersect_accelerator_spatial_splits;
+        mesh->_intersect_accelerator->_intersect_elem_clipped_bounds = [mesh](int elementid, const range3f& bbox){ return intersect_facemesh_element_clipped_bounds(mesh,elementid,bbox); };
+        shape->_intersect_accelerator->linear = shape->intersect_accelerator_linear;
+        shape->_intersect_accelerator->treelet_passes = shape->intersect_accelerator_treelet_passes;
         intersect_bvh_accelerate(shape->_intersect_accelerator);
+    } else if(is<MappedMesh>(shape)) {
+        auto mesh = cast<MappedMesh>(shape);
+        if(BVHAccelerator::min_prims > mesh->_triangle_num + mesh->_quad_num) return;
+        mesh->_intersect_accelerator =
+        new BVHAccelerator(mesh->_triangle_num + mesh->_quad_num,
+                           [mesh](int elementid){return intersect_mappedmesh_element_bounds(mesh,elementid);},
+                           [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_mappedmesh_element_first(mesh,elementid,ray,intersection); },
+                           [mesh](int elementid, const ray3f& ray){ return intersect_mappedmesh_element_any(mesh,elementid,ray); });
+        // use the bvh stored with the mesh if present, so that it is paged in together with the mesh
+        if(mesh->_nodes) {
+            mesh->_intersect_accelerator->_mapped_nodes_num = mesh->_nodes_num;
+            mesh->_intersect_accelerator->_mapped_nodes = mesh->_nodes;
+            mesh->_intersect_accelerator->_mapped_sorted_prims_num = mesh->_sorted_prims_num;
+            mesh->_intersect_accelerator->_mapped_sorted_prims = mesh->_sorted_prims;
+        }
+        else {
+            shape->_intersect_accelerator->linear = shape->intersect_accelerator_linear;
+            shape->_intersect_accelerator->treelet_passes = shape->intersect_accelerator_treelet_passes;
+            intersect_bvh_accelerate(shape->_intersect_accelerator);
+        }
     }
 }
 
@@ -316,16 +481,22 @@ bool intersect_shape_first(Shape* shape, const ray3f& ray, intersection3f& inter
     }
     else if(is<Mesh>(shape)) {
         auto mesh = cast<Mesh>(shape);
-        return _intersect_element_first(mesh->triangle.size() + mesh->quad.size()*2,
+        return _intersect_element_first(mesh->triangle.size() + mesh->quad.size(),
                                         [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_mesh_element_first(mesh,elementid,ray,intersection); },
                                         ray, intersection);
     }
     else if(is<FaceMesh>(shape)) {
         auto mesh = cast<FaceMesh>(shape);
-        return _intersect_element_first(mesh->triangle.size() + mesh->quad.size()*2,
+        return _intersect_element_first(mesh->triangle.size() + mesh->quad.size(),
                                         [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_facemesh_element_first(mesh,elementid,ray,intersection); },
                                         ray, intersection);
     }
+    else if(is<MappedMesh>(shape)) {
+        auto mesh = cast<MappedMesh>(shape);
+        return _intersect_element_first(mesh->_triangle_num + mesh->_quad_num,
+                                        [mesh](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_mappedmesh_element_first(mesh,elementid,ray,intersection); },
+                                        ray, intersection);
+    }
     else if(is<Sphere>(shape)) {
         auto sphere = cast<Sphere>(shape);
         
@@ -412,15 +583,20 @@ bool intersect_shape_any(Shape* shape, const ray3f& ray) {
         return false;
     }
     else if(is<Mesh>(shape)) {
-        for(int i = 0; i < cast<Mesh>(shape)->triangle.size() + cast<Mesh>(shape)->quad.size()*2; i ++)
+        for(int i = 0; i < cast<Mesh>(shape)->triangle.size() + cast<Mesh>(shape)->quad.size(); i ++)
             if(intersect_mesh_element_any(cast<Mesh>(shape),i,ray)) return true;
         return false;
     }
     else if(is<FaceMesh>(shape)) {
-        for(int i = 0; i < cast<FaceMesh>(shape)->triangle.size() + cast<Mesh>(shape)->quad.size()*2; i ++)
+        for(int i = 0; i < cast<FaceMesh>(shape)->triangle.size() + cast<FaceMesh>(shape)->quad.size(); i ++)
             if(intersect_facemesh_element_any(cast<FaceMesh>(shape),i,ray)) return true;
         return false;
     }
+    else if(is<MappedMesh>(shape)) {
+        for(int i = 0; i < cast<MappedMesh>(shape)->_triangle_num + cast<MappedMesh>(shape)->_quad_num; i ++)
+            if(intersect_mappedmesh_element_any(cast<MappedMesh>(shape),i,ray)) return true;
+        return false;
+    }
     else if(is<Sphere>(shape)) return intersect_sphere(ray, cast<Sphere>(shape)->center, cast<Sphere>(shape)->radius);
     else if(is<Cylinder>(shape)) return intersect_cylinder(ray, cast<Cylinder>(shape)->radius, cast<Cylinder>(shape)->height);
     else if(is<Quad>(shape)) return intersect_quad(ray, cast<Quad>(shape)->width, cast<Quad>(shape)->height);
@@ -430,31 +606,38 @@ bool intersect_shape_any(Shape* shape, const ray3f& ray) {
 
 range3f intersect_primitive_bounds(Primitive* prim) {
     auto bbox = range3f();
-    if(is<Surface>(prim)) bbox = intersect_shape_bounds(cast<Surface>(prim)->shape);
+    if(is<Surface>(prim)) bbox = intersect_shape_bounds(surface_rendered_shape(cast<Surface>(prim)));
     else if(is<TransformedSurface>(prim)) {
         auto transformed = cast<TransformedSurface>(prim);
         ERROR_IF_NOT(not transformed_animated(transformed), "intersect does not support animation");
-        bbox = transform_bbox(transformed_matrix(transformed, 0), intersect_shape_bounds(transformed->shape));
+        bbox = transform_bbox(transformed_matrix(transformed, 0), intersect_shape_bounds(transformed_rendered_shape(transformed)));
     }
     else NOT_IMPLEMENTED_ERROR();
     return transform_bbox(prim->frame, bbox);
 }
 
+// checked here once, since per-ray intersection only checks in debug builds
+void _intersect_primitive_check(Primitive* prim) {
+    if(is<TransformedSurface>(prim)) ERROR_IF_NOT(not transformed_animated(cast<TransformedSurface>(prim)), "intersect does not support animation");
+}
+
 void intersect_primitive_accelerate(Primitive* prim) {
-    if(is<Surface>(prim)) intersect_shape_accelerate(cast<Surface>(prim)->shape);
-    else if(is<TransformedSurface>(prim)) intersect_shape_accelerate(cast<TransformedSurface>(prim)->shape);
+    _intersect_primitive_check(prim);
+    if(is<Surface>(prim)) intersect_shape_accelerate(surface_rendered_shape(cast<Surface>(prim)));
+    else if(is<TransformedSurface>(prim)) intersect_shape_accelerate(transformed_rendered_shape(cast<TransformedSurface>(prim)));
     else NOT_IMPLEMENTED_ERROR();
 }
 
 bool intersect_primitive_first(Primitive* prim, const ray3f& ray, intersection3f& intersection) {
     auto hit = false;
     auto rayl = transform_ray_inverse(prim->frame,ray);
-    if(is<Surface>(prim)) hit = intersect_shape_first(cast<Surface>(prim)->shape, rayl, intersection);
+    if(is<Surface>(prim)) hit = intersect_shape_first(surface_rendered_shape(cast<Surface>(prim)), rayl, intersection);
     else if(is<TransformedSurface>(prim)) {
         auto transformed = cast<TransformedSurface>(prim);
-        ERROR_IF_NOT(not transformed_animated(transformed), "intersect does not support animation");
-        hit = intersect_shape_first(transformed->shape, transform_ray(transformed_matrix_inv(transformed,0), rayl),intersection);
-        if(hit) intersection = transform_intersection(transformed_matrix(transformed,0),transformed_matrix_inv(transformed,0),intersection);
+        DEBUG_ERROR_IF_NOT(not transformed_animated(transformed), "intersect does not support animation");
+        auto mi = transformed_matrix_inv(transformed,0);
+        hit = intersect_shape_first(transformed_rendered_shape(transformed), transform_ray(mi, rayl),intersection);
+        if(hit) intersection = transform_intersection(transformed_matrix(transformed,0),mi,intersection);
     }
     else NOT_IMPLEMENTED_ERROR();
     if(hit) {
@@ -467,11 +650,11 @@ bool intersect_primitive_first(Primitive* prim, const ray3f& ray, intersection3f
 
 bool intersect_primitive_any(Primitive* prim, const ray3f& ray) {
     auto rayl = transform_ray_inverse(prim->frame,ray);
-    if(is<Surface>(prim)) return intersect_shape_any(cast<Surface>(prim)->shape,rayl);
+    if(is<Surface>(prim)) return intersect_shape_any(surface_rendered_shape(cast<Surface>(prim)),rayl);
     else if(is<TransformedSurface>(prim)) {
         auto transformed = cast<TransformedSurface>(prim);
-        ERROR_IF_NOT(not transformed_animated(transformed), "intersect does not support animation");
-        return intersect_shape_any(transformed->shape,transform_ray(transformed_matrix_inv(transformed,0), rayl));
+        DEBUG_ERROR_IF_NOT(not transformed_animated(transformed), "intersect does not support animation");
+        return intersect_shape_any(transformed_rendered_shape(transformed),transform_ray(transformed_matrix_inv(transformed,0), rayl));
     }
     else { NOT_IMPLEMENTED_ERROR(); return false; }
 }
@@ -484,15 +667,28 @@ range3f intersect_primitives_bounds(PrimitiveGroup* group) {
     return bbox;
 }
 
-void intersect_primitives_accelerate(PrimitiveGroup* group) {
-    for(auto p : group->prims) intersect_primitive_accelerate(p);
+// with reuse, shapes that already have an accelerator keep it, so that only the primitive accelerator is rebuilt
+void intersect_primitives_accelerate(PrimitiveGroup* group, bool reuse) {
+    // shapes shared by several primitives, e.g. merged by scene_deduplicate, are accelerated once
+    auto accelerated = map<Shape*,bool>();
+    for(auto p : group->prims) {
+        auto shape = (is<Surface>(p)) ? surface_rendered_shape(cast<Surface>(p)) : (is<TransformedSurface>(p)) ? transformed_rendered_shape(cast<TransformedSurface>(p)) : nullptr;
+        if(shape and reuse and (shape->_intersect_accelerator or (shape->_tesselation and shape->_tesselation->_intersect_accelerator))) accelerated[shape] = true;
+        if(shape and accelerated[shape]) { _intersect_primitive_check(p); continue; }
+        intersect_primitive_accelerate(p);
+        accelerated[shape] = true;
+    }
     if(group->_intersect_accelerator) { delete group->_intersect_accelerator; group->_intersect_accelerator = nullptr; }
     if(group->intersect_accelerator_use and BVHAccelerator::min_prims < group->prims.size()) {
         vector<range3f> bboxes;
         for(auto p : group->prims) bboxes.push_back(intersect_primitive_bounds(p));
         auto bvh = new BVHAccelerator(group->prims.size(),
                                       [group](int elementid){ return intersect_primitive_bounds(group->prims[elementid]); },
-                                      [group](int elementid, const ray3f& ray, intersection3f& intersection){ return intersect_primitive_first(group->prims[elementid], ray, intersection); },
+                                      [group](int elementid, const ray3f& ray, intersection3f& intersection){
+                                          if(not intersect_primitive_first(group->prims[elementid], ray, intersection)) return false;
+                                          intersection.prim_id = elementid;
+                                          return true;
+                                      },
                                       [group](int elementid, const ray3f& ray){ return intersect_primitive_any(group->prims[elementid], ray); } );
         intersect_bvh_accelerate(bvh);
         group->_intersect_accelerator = bvh;
@@ -505,14 +701,15 @@ bool intersect_primitives_first(PrimitiveGroup* group, const ray3f& ray, interse
     else {
         float mint = ray3f::rayinf;
         ray3f sray = ray;
-        for(auto p : group->prims) {
+        for(auto pid : range(group->prims.size())) {
             intersection3f sintersection;
-            if(intersect_primitive_first(p, sray, sintersection)) {
+            if(intersect_primitive_first(group->prims[pid], sray, sintersection)) {
                 if(mint > sintersection.ray_t) {
                     hit = true;
                     mint = sintersection.ray_t;
                     sray.tmax = mint;
                     intersection = sintersection;
+                    intersection.prim_id = pid;
                 }
             }
         }
@@ -528,10 +725,34 @@ bool intersect_primitives_any(PrimitiveGroup* group, const ray3f& ray) {
 
 
 
-void intersect_scene_accelerate(Scene* scene) { intersect_primitives_accelerate(scene->prims); }
+void intersect_scene_accelerate(Scene* scene) { intersect_primitives_accelerate(scene->prims, false); }
+void intersect_scene_reaccelerate(Scene* scene) { intersect_primitives_accelerate(scene->prims, true); }
 range3f intersect_scene_bounds(Scene* scene) { return intersect_primitives_bounds(scene->prims); }
 
 bool intersect_scene_first(Scene* scene, const ray3f& ray, intersection3f& intersection) { return intersect_primitives_first(scene->prims, ray, intersection); }
 bool intersect_scene_any(Scene* scene, const ray3f& ray) { return intersect_primitives_any(scene->prims, ray); }
 
+void _intersect_scene_batch(Scene* scene, int nrays, const function<ray3f(int)>& ray, RayHit* hits, bool any) {
+    parallel_for_dynamic((nrays + intersect_batch_chunk - 1) / intersect_batch_chunk, [&](int chunk, int thread){
+        for(auto i : range(chunk*intersect_batch_chunk, min(nrays, (chunk+1)*intersect_batch_chunk))) {
+            auto& hit = hits[i];
+            hit = RayHit();
+            if(any) { hit.hit = intersect_scene_any(scene, ray(i)); continue; }
+            auto intersection = intersection3f();
+            if(not intersect_scene_first(scene, ray(i), intersection)) continue;
+            hit.hit = true;
+            hit.t = intersection.ray_t;
+            hit.prim = intersection.prim_id;
+            hit.element = intersection.element_id;
+            hit.uv = intersection.uv;
+        }
+    });
+}
+
+void intersect_scene_batch(Scene* scene, const ray3f* rays, int nrays, RayHit* hits, bool any) {
+    _intersect_scene_batch(scene, nrays, [rays](int i){ return rays[i]; }, hits, any);
+}
 
+void intersect_scene_batch(Scene* scene, const RayBatch& rays, RayHit* hits, bool any) {
+    _intersect_scene_batch(scene, rays.origin.size(), [&rays](int i){ return ray3f(rays.origin[i],rays.direction[i],rays.tmin[i],rays.tmax[i]); }, hits, any);
+}
@@ -12,6 +12,7 @@
 struct Material;
 struct Scene;
 struct Shape;
+struct Primitive;
 
 /// intersection record
 struct intersection3f {
@@ -21,6 +22,8 @@ struct intersection3f {
 	vec2f                   uv; ///< intersection shape uv
 	vec2f                   texcoord; ///< intersection texcoord
 	Material*               material; ///< intersection material
+	int                     prim_id = -1; ///< intersected primitive index in the scene
+	int                     element_id = -1; ///< intersected element index in the shape (-1 for shapes made of one element; for meshes the triangle index of mesh_triangle_face)
 };
 
 /// transform an intersection elements by a frame
@@ -42,17 +45,50 @@ inline intersection3f transform_intersection(const mat4f& m, const mat4f& mi, co
 ///@name intersection interface
 ///@{
 void intersect_scene_accelerate(Scene* scene);
+/// rebuilds the primitive accelerator after surfaces changed shape (e.g. level of detail), accelerating only the
+/// shapes that have no accelerator yet
+void intersect_scene_reaccelerate(Scene* scene);
 range3f intersect_scene_bounds(Scene* scene);
+range3f intersect_primitive_bounds(Primitive* prim);
 
 bool intersect_scene_first(Scene* scene, const ray3f& ray, intersection3f& intersection);
 bool intersect_scene_any(Scene* scene, const ray3f& ray);
 
 bool intersect_shape_first(Shape* shape, const ray3f& ray, intersection3f& intersection);
 void intersect_shape_accelerate(Shape* shape);
+range3f intersect_shape_bounds(Shape* shape);
 
 
 ///@}
 
+///@name batch intersection interface (for tools that need intersection but not rendering)
+///@{
+/// batch ray hit
+struct RayHit {
+    bool    hit = false; ///< whether the ray hit anything (the only value computed for any-hit queries)
+    float   t = ray3f::rayinf; ///< hit ray parameter
+    int     prim = -1; ///< hit primitive index in the scene
+    int     element = -1; ///< hit element index in the primitive shape (-1 for shapes made of one element)
+    vec2f   uv = zero2f; ///< hit barycentric coordinates for mesh elements, shape uv otherwise
+};
+
+/// batch of rays stored as a structure of arrays
+struct RayBatch {
+    vector<vec3f> origin; ///< ray origins
+    vector<vec3f> direction; ///< ray directions
+    vector<float> tmin; ///< ray min t values
+    vector<float> tmax; ///< ray max t values
+};
+
+/// rays per work item handed to a thread
+const int intersect_batch_chunk = 256;
+
+/// intersects nrays rays in parallel, closest hit or (if any) any hit; scene should be already tesselated and accelerated
+void intersect_scene_batch(Scene* scene, const ray3f* rays, int nrays, RayHit* hits, bool any);
+/// intersects a batch of rays in parallel, closest hit or (if any) any hit; scene should be already tesselated and accelerated
+void intersect_scene_batch(Scene* scene, const RayBatch& rays, RayHit* hits, bool any);
+///@}
+
 ///@}
 
 #endif
@@ -1,3 +1,37 @@
 #include "light.h"
 
 ///@file igl/light.cpp Lights. @ingroup igl
+
+void envlight_sh_init(EnvLight* env) {
+    // integrate over texels of the latlong envmap (v = acos(z)/pi as for spheres), or a fixed grid without one
+    auto w = (env->envmap) ? env->envmap->image.width() : 64;
+    auto h = (env->envmap) ? env->envmap->image.height() : 32;
+    // per-row sums are accumulated in order afterwards, so the result does not depend on threading
+    auto rows = vector<vector<vec3f>>(h, vector<vec3f>(sh_coeffs, zero3f));
+    parallel_for(h, [&](int start, int end) {
+        float y[sh_coeffs];
+        for(int j = start; j < end; j ++) {
+            auto theta = pif * (j + 0.5f) / h;
+            auto solid_angle = (2*pif / w) * (pif / h) * sin(theta);
+            for(int i = 0; i < w; i ++) {
+                auto phi = 2*pif * (i + 0.5f) / w;
+                auto d = vec3f(sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta));
+                if(env->hemisphere and d.z <= 0) continue;
+                auto radiance = env->intensity * ((env->envmap) ? env->envmap->image.at(i,j) : one3f);
+                sh_basis(d, y);
+                for(int k = 0; k < sh_coeffs; k ++) rows[j][k] += radiance * (y[k] * solid_angle);
+            }
+        }
+    });
+    auto sh = vector<vec3f>(sh_coeffs, zero3f);
+    for(auto& row : rows) for(int k = 0; k < sh_coeffs; k ++) sh[k] += row[k];
+    
+    // the linear band points to where most light comes from
+    auto dominant = vec3f(mean_component(sh[3]), mean_component(sh[1]), mean_component(sh[2]));
+    env->_sh_dominant_dir = (length(dominant) > 0) ? normalize(dominant) : z3f;
+    
+    // convolve with the clamped cosine to get irradiance (Ramamoorthi and Hanrahan 2001)
+    const float band[sh_coeffs] = { pif, 2*pif/3, 2*pif/3, 2*pif/3, pif/4, pif/4, pif/4, pif/4, pif/4 };
+    for(int k = 0; k < sh_coeffs; k ++) sh[k] *= band[k];
+    env->_sh_irradiance = sh;
+}
@@ -52,6 +52,9 @@ struct EnvLight : Light {
     bool                importance_sampling = true; ///< whether to use importance sampling for the texture
     
     Distribution2D*     _importance_distribution = nullptr; ///< whether to use importance sampling
+    
+    vector<vec3f>       _sh_irradiance; ///< irradiance as order-2 spherical harmonics in the light frame (empty until sample_lights_init with envlight_sh)
+    vec3f               _sh_dominant_dir = z3f; ///< direction the most light comes from in the light frame
 };
 
 /// Group of Lights
@@ -61,6 +64,49 @@ struct LightGroup : Node {
     vector<Light*>      lights;
 };
 
+///@name spherical harmonics
+///@{
+/// number of order-2 real spherical harmonics coefficients
+const int sh_coeffs = 9;
+/// value of the constant basis function
+const float sh_basis_constant = 0.282095f;
+
+/// evaluates the order-2 real spherical harmonics basis in direction d
+inline void sh_basis(const vec3f& d, float* y) {
+    y[0] = sh_basis_constant;
+    y[1] = 0.488603f * d.y;
+    y[2] = 0.488603f * d.z;
+    y[3] = 0.488603f * d.x;
+    y[4] = 1.092548f * d.x * d.y;
+    y[5] = 1.092548f * d.y * d.z;
+    y[6] = 0.315392f * (3 * d.z * d.z - 1);
+    y[7] = 1.092548f * d.x * d.z;
+    y[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+/// irradiance for normal n from spherical harmonics already convolved with the clamped cosine
+inline vec3f sh_irradiance(const vector<vec3f>& sh, const vec3f& n) {
+    float y[sh_coeffs];
+    sh_basis(n, y);
+    auto e = zero3f;
+    for(int i = 0; i < sh_coeffs; i ++) e += sh[i] * y[i];
+    return max(e, zero3f);
+}
+///@}
+
+///@name envlight irradiance
+///@{
+/// projects the envlight radiance (envmap times intensity, only the upper half if hemisphere) on spherical harmonics
+void envlight_sh_init(EnvLight* env);
+
+/// irradiance for world normal n and whether a visibility ray towards the dominant direction was occluded;
+/// an occluded point only keeps the uniform part of the environment
+inline vec3f envlight_sh_irradiance(EnvLight* env, const vec3f& n, bool occluded) {
+    if(occluded) return max(env->_sh_irradiance[0] * sh_basis_constant, zero3f);
+    return sh_irradiance(env->_sh_irradiance, transform_direction_inverse(env->frame, n));
+}
+///@}
+
 ///@name sample interface
 /// requsted number of shadow rays
 inline int light_shadow_nsamples(Light* light) {
@@ -154,14 +200,26 @@ inline ShadowSample rand_light_shadow_sample(Light* light,
 inline vec3f light_sample_background(Light* light, const vec3f& wo) {
     auto wol = transform_direction_inverse(light->frame, wo);
     if(is<EnvLight>(light)) {
-        auto sample = cast<EnvLight>(light)->intensity;
+        auto env = cast<EnvLight>(light);
+        if(env->hemisphere and wol.z <= 0) return zero3f;
+        auto sample = env->intensity;
+        if(env->envmap) {
+            // latlong lookup, with theta along v as in envlight_sh_init
+            auto& img = env->envmap->image;
+            auto phi = atan2(wol.y,wol.x);
+            if(phi < 0) phi += 2*pif;
+            auto i = clamp((int)(phi / (2*pif) * img.width()), 0, img.width()-1);
+            auto j = clamp((int)(acos(clamp(wol.z,-1.0f,1.0f)) / pif * img.height()), 0, img.height()-1);
+            sample *= img.at(i,j);
+        }
         return sample;
     } else return zero3f;
 }
 
-/// init light sampling
-inline void sample_light_init(Light* light) {
+/// init light sampling, and envlight irradiance if shading with it (envlight_sh)
+inline void sample_light_init(Light* light, bool envlight_sh = false) {
     if(is<EnvLight>(light)) {
+        if(envlight_sh) envlight_sh_init(cast<EnvLight>(light));
         if(not cast<EnvLight>(light)->importance_sampling or not cast<EnvLight>(light)->envmap) return;
         if(cast<EnvLight>(light)->_importance_distribution) delete cast<EnvLight>(light)->_importance_distribution;
         const image<vec3f>& txt = cast<EnvLight>(light)->envmap->image;
@@ -180,8 +238,8 @@ inline void sample_light_init(Light* light) {
     } else {}
 }
 
-/// init light sampling
-inline void sample_lights_init(LightGroup* lights) { for(auto light : lights->lights) sample_light_init(light); }
+/// init light sampling, and envlight irradiance if shading with it (envlight_sh)
+inline void sample_lights_init(LightGroup* lights, bool envlight_sh = false) { for(auto light : lights->lights) sample_light_init(light, envlight_sh); }
 
 ///@}
 
@@ -0,0 +1,203 @@
+#include "mapped.h"
+
+#include "intersect.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+///@file igl/mapped.cpp Memory-mapped geometry. @ingroup igl
+
+// binary layout: header followed by page-aligned arrays; the bvh indexes triangles followed by whole quads
+struct _MappedMeshHeader {
+    char    magic[8] = { 'I','G','L','M','E','S','H','2' };
+    int     pos_num = 0, norm_num = 0, texcoord_num = 0, triangle_num = 0, quad_num = 0, nodes_num = 0, sorted_prims_num = 0;
+    long    pos_offset = 0, norm_offset = 0, texcoord_offset = 0, triangle_offset = 0, quad_offset = 0, nodes_offset = 0, sorted_prims_offset = 0;
+};
+
+const long _mappedmesh_align = 4096;
+
+long _mappedmesh_aligned(long offset) { return (offset + _mappedmesh_align - 1) / _mappedmesh_align * _mappedmesh_align; }
+
+// append the subtree rooted at the already appended node i depth-first
+void _mappedmesh_depthfirst_nodes(BVHAccelerator* bvh, vector<BVHNode>& nodes, int i) {
+    if(nodes[i].leaf) return;
+    auto n0 = nodes[i].n0, n1 = nodes[i].n1;
+    nodes[i].n0 = nodes.size(); nodes.push_back(bvh->node(n0));
+    _mappedmesh_depthfirst_nodes(bvh, nodes, nodes[i].n0);
+    nodes[i].n1 = nodes.size(); nodes.push_back(bvh->node(n1));
+    _mappedmesh_depthfirst_nodes(bvh, nodes, nodes[i].n1);
+}
+
+// relayout nodes (dropping unreachable ones) following traversal order: the top levels, visited by every ray,
+// breadth-first in the first mappedmesh_resident_nodes; below them each subtree depth-first so that a ray
+// descending into it touches as few pages as possible
+vector<BVHNode> _mappedmesh_traversal_nodes(BVHAccelerator* bvh) {
+    auto nodes = vector<BVHNode>{ bvh->node(0) };
+    auto frontier = 0;
+    for(; frontier < nodes.size() and nodes.size() + 2 <= mappedmesh_resident_nodes; frontier ++) {
+        if(nodes[frontier].leaf) continue;
+        auto n0 = nodes[frontier].n0, n1 = nodes[frontier].n1;
+        nodes[frontier].n0 = nodes.size(); nodes.push_back(bvh->node(n0));
+        nodes[frontier].n1 = nodes.size(); nodes.push_back(bvh->node(n1));
+    }
+    for(int i = frontier, top = nodes.size(); i < top; i ++) _mappedmesh_depthfirst_nodes(bvh, nodes, i);
+    return nodes;
+}
+
+template<typename T>
+void _mappedmesh_write_array(FILE* f, long offset, const T* data, int num) {
+    if(not num) return;
+    fseek(f, offset, SEEK_SET);
+    fwrite(data, sizeof(T), num, f);
+}
+
+void mappedmesh_write(const string& filename, Mesh* mesh, bool accelerate) {
+    auto nodes = vector<BVHNode>();
+    auto sorted_prims = vector<int>();
+    if(accelerate) {
+        intersect_shape_accelerate(mesh);
+        if(mesh->_intersect_accelerator) {
+            nodes = _mappedmesh_traversal_nodes(mesh->_intersect_accelerator);
+            sorted_prims = mesh->_intersect_accelerator->sorted_prims;
+        }
+    }
+
+    auto header = _MappedMeshHeader();
+    header.pos_num = mesh->pos.size();
+    header.norm_num = mesh->norm.size();
+    header.texcoord_num = mesh->texcoord.size();
+    header.triangle_num = mesh->triangle.size();
+    header.quad_num = mesh->quad.size();
+    header.nodes_num = nodes.size();
+    header.sorted_prims_num = sorted_prims.size();
+    header.pos_offset = _mappedmesh_aligned(sizeof(_MappedMeshHeader));
+    header.norm_offset = _mappedmesh_aligned(header.pos_offset + header.pos_num*sizeof(vec3f));
+    header.texcoord_offset = _mappedmesh_aligned(header.norm_offset + header.norm_num*sizeof(vec3f));
+    header.triangle_offset = _mappedmesh_aligned(header.texcoord_offset + header.texcoord_num*sizeof(vec2f));
+    header.quad_offset = _mappedmesh_aligned(header.triangle_offset + header.triangle_num*sizeof(vec3i));
+    header.nodes_offset = _mappedmesh_aligned(header.quad_offset + header.quad_num*sizeof(vec4i));
+    header.sorted_prims_offset = _mappedmesh_aligned(header.nodes_offset + header.nodes_num*sizeof(BVHNode));
+
+    auto f = fopen(filename.c_str(), "wb");
+    ERROR_IF_NOT(f, "cannot open file %s", filename.c_str());
+    fwrite(&header, sizeof(header), 1, f);
+    _mappedmesh_write_array(f, header.pos_offset, mesh->pos.data(), header.pos_num);
+    _mappedmesh_write_array(f, header.norm_offset, mesh->norm.data(), header.norm_num);
+    _mappedmesh_write_array(f, header.texcoord_offset, mesh->texcoord.data(), header.texcoord_num);
+    _mappedmesh_write_array(f, header.triangle_offset, mesh->triangle.data(), header.triangle_num);
+    _mappedmesh_write_array(f, header.quad_offset, mesh->quad.data(), header.quad_num);
+    _mappedmesh_write_array(f, header.nodes_offset, nodes.data(), header.nodes_num);
+    _mappedmesh_write_array(f, header.sorted_prims_offset, sorted_prims.data(), header.sorted_prims_num);
+    fclose(f);
+}
+
+#ifndef _WIN32
+
+void _mappedmesh_advise(const void* data, size_t size, int advice) {
+    if(not data or not size) return;
+    auto start = (long)data / _mappedmesh_align * _mappedmesh_align;
+    auto end = _mappedmesh_aligned((long)data + size);
+    madvise((void*)start, end - start, advice);
+}
+
+// whether an array of num T at offset lies after the header and within a file of size bytes, aligned for T
+template<typename T>
+bool _mappedmesh_valid_array(long offset, int num, long size) {
+    if(num < 0) return false;
+    if(not num) return true;
+    return offset >= (long)sizeof(_MappedMeshHeader) and offset % alignof(T) == 0 and offset <= size and num <= (size - offset) / (long)sizeof(T);
+}
+
+void mappedmesh_map(MappedMesh* mesh) {
+    if(mesh->_mapped_data) mappedmesh_unmap(mesh);
+    auto fd = open(mesh->filename.c_str(), O_RDONLY);
+    ERROR_IF_NOT(fd >= 0, "cannot open file %s", mesh->filename.c_str());
+    struct stat st;
+    ERROR_IF_NOT(fstat(fd, &st) == 0, "cannot stat file %s", mesh->filename.c_str());
+    ERROR_IF_NOT(st.st_size >= sizeof(_MappedMeshHeader), "unknown file format %s", mesh->filename.c_str());
+    auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ERROR_IF_NOT(data != MAP_FAILED, "cannot map file %s", mesh->filename.c_str());
+
+    auto bytes = (const char*)data;
+    auto header = (const _MappedMeshHeader*)data;
+    ERROR_IF_NOT(not strncmp(header->magic, _MappedMeshHeader().magic, 8), "unknown file format %s", mesh->filename.c_str());
+    // arrays are checked against the file size here, so that truncated or corrupt files fail at load instead of
+    // during traversal (indices are not, since that would page in the whole file)
+    auto size = (long)st.st_size;
+    ERROR_IF_NOT(_mappedmesh_valid_array<vec3f>(header->pos_offset, header->pos_num, size) and
+                 (header->norm_num == 0 or header->norm_num == header->pos_num) and
+                 _mappedmesh_valid_array<vec3f>(header->norm_offset, header->norm_num, size) and
+                 (header->texcoord_num == 0 or header->texcoord_num == header->pos_num) and
+                 _mappedmesh_valid_array<vec2f>(header->texcoord_offset, header->texcoord_num, size) and
+                 _mappedmesh_valid_array<vec3i>(header->triangle_offset, header->triangle_num, size) and
+                 _mappedmesh_valid_array<vec4i>(header->quad_offset, header->quad_num, size) and
+                 _mappedmesh_valid_array<BVHNode>(header->nodes_offset, header->nodes_num, size) and
+                 _mappedmesh_valid_array<int>(header->sorted_prims_offset, header->sorted_prims_num, size),
+                 "corrupt file %s", mesh->filename.c_str());
+    mesh->_mapped_data = data;
+    mesh->_mapped_size = st.st_size;
+    mesh->_pos_num = header->pos_num;
+    mesh->_pos = (const vec3f*)(bytes + header->pos_offset);
+    mesh->_norm = (header->norm_num) ? (const vec3f*)(bytes + header->norm_offset) : nullptr;
+    mesh->_texcoord = (header->texcoord_num) ? (const vec2f*)(bytes + header->texcoord_offset) : nullptr;
+    mesh->_triangle_num = header->triangle_num;
+    mesh->_triangle = (const vec3i*)(bytes + header->triangle_offset);
+    mesh->_quad_num = header->quad_num;
+    mesh->_quad = (const vec4i*)(bytes + header->quad_offset);
+    mesh->_nodes_num = header->nodes_num;
+    mesh->_nodes = (header->nodes_num) ? (const BVHNode*)(bytes + header->nodes_offset) : nullptr;
+    mesh->_sorted_prims_num = header->sorted_prims_num;
+    mesh->_sorted_prims = (header->sorted_prims_num) ? (const int*)(bytes + header->sorted_prims_offset) : nullptr;
+
+    // rays reach leaves and vertices in no particular order, so disable readahead;
+    // the breadth-first top of the bvh is visited by every ray, so fetch it right away
+    madvise(data, st.st_size, MADV_RANDOM);
+    _mappedmesh_advise(mesh->_nodes, min(mesh->_nodes_num, mappedmesh_resident_nodes)*sizeof(BVHNode), MADV_WILLNEED);
+}
+
+void mappedmesh_unmap(MappedMesh* mesh) {
+    if(not mesh->_mapped_data) return;
+    munmap(mesh->_mapped_data, mesh->_mapped_size);
+    mesh->_mapped_data = nullptr; mesh->_mapped_size = 0;
+    mesh->_pos_num = 0; mesh->_pos = nullptr; mesh->_norm = nullptr; mesh->_texcoord = nullptr;
+    mesh->_triangle_num = 0; mesh->_triangle = nullptr; mesh->_quad_num = 0; mesh->_quad = nullptr;
+    mesh->_nodes_num = 0; mesh->_nodes = nullptr; mesh->_sorted_prims_num = 0; mesh->_sorted_prims = nullptr;
+}
+
+size_t mappedmesh_resident_bytes(MappedMesh* mesh) {
+    if(not mesh->_mapped_data) return 0;
+    auto page = sysconf(_SC_PAGESIZE);
+    auto pages = (mesh->_mapped_size + page - 1) / page;
+    auto resident = vector<unsigned char>(pages);
+    if(mincore(mesh->_mapped_data, mesh->_mapped_size, resident.data())) return 0;
+    size_t count = 0;
+    for(auto r : resident) if(r & 1) count ++;
+    return count * page;
+}
+
+size_t process_resident_bytes_max() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024l;
+#endif
+}
+
+#else
+
+void mappedmesh_map(MappedMesh* mesh) { NOT_IMPLEMENTED_ERROR(); }
+void mappedmesh_unmap(MappedMesh* mesh) { NOT_IMPLEMENTED_ERROR(); }
+size_t mappedmesh_resident_bytes(MappedMesh* mesh) { return 0; }
+size_t process_resident_bytes_max() { return 0; }
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _MAPPED_H_
+#define _MAPPED_H_
+
+#include "primitive.h"
+
+///@file igl/mapped.h Memory-mapped geometry. @ingroup igl
+///@defgroup mapped Memory-mapped geometry
+///@ingroup igl
+///@{
+
+/// number of bvh nodes (in breadth-first order) hinted to be always resident when mapping
+const int mappedmesh_resident_nodes = 4096;
+
+///@name binary mesh interface
+///@{
+void mappedmesh_write(const string& filename, Mesh* mesh, bool accelerate);
+void mappedmesh_map(MappedMesh* mesh);
+void mappedmesh_unmap(MappedMesh* mesh);
+///@}
+
+///@name memory reporting interface (mapped bytes currently in memory, process peak resident set)
+///@{
+size_t mappedmesh_resident_bytes(MappedMesh* mesh);
+size_t process_resident_bytes_max();
+///@}
+
+///@}
+
+#endif
@@ -83,7 +83,7 @@ inline bool material_has_textures(Material* material) {
         auto emission = cast<LambertEmission>(material);
         return emission->diffuse_texture or emission->emission_texture;
     }
-    else { NOT_IMPLEMENTED_ERROR(); return nullptr; }
+    else { NOT_IMPLEMENTED_ERROR(); return false; }
 }
 
 /// evalute perturbed shading frame
@@ -107,13 +107,13 @@ inline Material* material_shading_textures(Material* material, const vec2f& texc
         ret->diffuse = phong->diffuse;
 
         // Textures
-        if (material_has_textures(material)) {
-            image3f img = phong->diffuse_texture->image;
+        if (phong->diffuse_texture) {
+            const image3f& img = phong->diffuse_texture->image;
             auto u = texcoord.x;
             auto v = texcoord.y;
 
-            int x = clamp((int)(u * img.width()), 0, img.width());
-            int y = clamp((int)(v * img.height()), 0, img.height());
+            int x = clamp((int)(u * img.width()), 0, img.width()-1);
+            int y = clamp((int)(v * img.height()), 0, img.height()-1);
             ret->diffuse *= img.at(x,y);
 
         }
@@ -135,7 +135,7 @@ inline Material* material_shading_textures(Material* material, const vec2f& texc
 
 /// evaluate the material color
 inline vec3f material_diffuse_albedo(Material* material) {
-    ERROR_IF_NOT(not material_has_textures(material), "cannot support textures");
+    DEBUG_ERROR_IF_NOT(not material_has_textures(material), "cannot support textures");
     if(is<Lambert>(material)) return cast<Lambert>(material)->diffuse;
     else if(is<Phong>(material)) return cast<Phong>(material)->diffuse;
     else if(is<LambertEmission>(material)) return cast<LambertEmission>(material)->diffuse;
@@ -144,7 +144,7 @@ inline vec3f material_diffuse_albedo(Material* material) {
 
 /// evaluete the emission of the material
 inline vec3f material_emission(Material* material, const frame3f& frame, const vec3f& wo) {
-    ERROR_IF_NOT(not material_has_textures(material), "cannot support textures");
+    DEBUG_ERROR_IF_NOT(not material_has_textures(material), "cannot support textures");
     if(is<LambertEmission>(material)) {
         auto lambert = cast<LambertEmission>(material);
         if(dot(wo,frame.z) <= 0) return zero3f;
@@ -164,7 +164,7 @@ inline vec3f _schlickFresnel(const vec3f& rhos, const vec3f& w, const vec3f& wh)
 
 /// evaluate product of BRDF and cosine
 inline vec3f material_brdfcos(Material* material, const frame3f& frame, const vec3f& wi, const vec3f& wo) {
-    ERROR_IF_NOT(not material_has_textures(material), "cannot support textures");
+    DEBUG_ERROR_IF_NOT(not material_has_textures(material), "cannot support textures");
     if(is<Lambert>(material)) {
         auto lambert = cast<Lambert>(material);
         if(dot(wi,frame.z) <= 0 or dot(wo,frame.z) <= 0) return zero3f;
@@ -208,7 +208,7 @@ struct BrdfSample {
 
 /// evaluate color and direction of mirror reflection (zero if not reflections)
 inline BrdfSample material_sample_reflection(Material* material, const frame3f& frame, const vec3f& wo) {
-    ERROR_IF_NOT(not material_has_textures(material), "no textures allowed");
+    DEBUG_ERROR_IF_NOT(not material_has_textures(material), "no textures allowed");
     if(is<Phong>(material)) {
         auto phong = cast<Phong>(material);
         if(dot(wo,frame.z) <= 0) return BrdfSample();
@@ -223,7 +223,7 @@ inline BrdfSample material_sample_reflection(Material* material, const frame3f&
 
 /// evaluate color and direction of blurred mirror reflection (zero if not reflections)
 inline BrdfSample material_sample_blurryreflection(Material* material, const frame3f& frame, const vec3f& wo, const vec2f& suv) {
-    ERROR_IF_NOT(not material_has_textures(material), "no textures allowed");
+    DEBUG_ERROR_IF_NOT(not material_has_textures(material), "no textures allowed");
     auto bs = BrdfSample();
     if(is<Phong>(material)) {
         auto phong = cast<Phong>(material);
@@ -244,7 +244,7 @@ inline BrdfSample material_sample_blurryreflection(Material* material, const fra
 
 /// pick a direction and sample it
 inline BrdfSample material_sample_brdfcos(Material* material, const frame3f& frame, const vec3f& wo, const vec2f& suv, float sl) {
-    ERROR_IF_NOT(not material_has_textures(material), "no textures allowed");
+    DEBUG_ERROR_IF_NOT(not material_has_textures(material), "no textures allowed");
     if(is<Lambert>(material)) {
         auto lambert = cast<Lambert>(material);
         if(dot(wo,frame.z) <= 0) return BrdfSample();
@@ -281,6 +281,12 @@ inline BrdfSample material_sample_brdfcos(Material* material, const frame3f& fra
     else { NOT_IMPLEMENTED_ERROR(); return BrdfSample(); }
 }
 
+/// pdf of material_sample_brdfcos picking direction wi
+inline float material_sample_brdfcos_pdf(Material* material, const frame3f& frame, const vec3f& wo, const vec3f& wi) {
+    if(dot(wo,frame.z) <= 0) return 0;
+    return sample_direction_hemisphericalcos_pdf(transform_direction_inverse(frame, wi));
+}
+
 ///@}
 
 ///@}
@@ -0,0 +1,180 @@
+#include "pathguide.h"
+
+///@file igl/pathguide.cpp Path guiding. @ingroup igl
+
+// cylindrical coordinates of a direction in [0,1)^2 (area preserving, so a uniform uv is a uniform direction)
+vec2f _pathguide_direction_to_uv(const vec3f& d) {
+    auto phi = atan2(d.y,d.x) / (2*pif);
+    if(phi < 0) phi += 1;
+    return vec2f(clamp((d.z+1)/2,0.0f,1.0f), clamp(phi,0.0f,1.0f));
+}
+
+// direction of cylindrical coordinates
+vec3f _pathguide_uv_to_direction(const vec2f& uv) {
+    auto z = 2*uv.x-1;
+    auto r = sqrt(max(0.0f,1-z*z));
+    auto phi = 2*pif*uv.y;
+    return vec3f(r*cos(phi), r*sin(phi), z);
+}
+
+// total radiance of a quadtree node
+float _pathguide_node_sum(const PathGuideQuadNode& node) {
+    return node.sum[0].get() + node.sum[1].get() + node.sum[2].get() + node.sum[3].get();
+}
+
+// quadrant of uv in the unit square, with uv rescaled to the quadrant
+int _pathguide_quadrant(vec2f& uv) {
+    auto qx = (uv.x >= 0.5f) ? 1 : 0, qy = (uv.y >= 0.5f) ? 1 : 0;
+    uv = vec2f(uv.x*2-qx, uv.y*2-qy);
+    return qx + 2*qy;
+}
+
+PathGuide* pathguide_init(const range3f& bbox) {
+    auto guide = new PathGuide();
+    // cubic, so that splitting axes in turn keeps cells close to cubes
+    auto c = center(bbox);
+    auto r = max_component(size(bbox))/2 * 1.001f;
+    guide->bbox = range3f(c-vec3f(r,r,r), c+vec3f(r,r,r));
+    return guide;
+}
+
+void pathguide_free(PathGuide* guide) {
+    delete guide;
+}
+
+int pathguide_leaf(PathGuide* guide, const vec3f& p) {
+    auto bbox = guide->bbox;
+    auto node = 0;
+    while(guide->nodes[node].child[0]) {
+        auto axis = guide->nodes[node].axis;
+        auto mid = (bbox.min[axis]+bbox.max[axis])/2;
+        if(p[axis] < mid) { bbox.max[axis] = mid; node = guide->nodes[node].child[0]; }
+        else { bbox.min[axis] = mid; node = guide->nodes[node].child[1]; }
+    }
+    return guide->nodes[node].leaf;
+}
+
+vec3f pathguide_sample(const PathGuideDirections& dirs, const vec2f& ruv) {
+    auto r = ruv;
+    auto origin = zero2f;
+    auto size = 1.0f;
+    auto node = 0;
+    while(true) {
+        auto& n = dirs.nodes[node];
+        auto total = _pathguide_node_sum(n);
+        if(total <= 0) break;
+        // pick the row by its radiance, then the quadrant in the row, reusing the rescaled random numbers
+        auto bottom = n.sum[0].get() + n.sum[1].get();
+        auto qy = 0;
+        if(r.y < bottom / total) r.y = r.y * total / bottom;
+        else { qy = 1; r.y = (r.y - bottom / total) * total / (total - bottom); }
+        auto left = n.sum[2*qy].get(), row = left + n.sum[2*qy+1].get();
+        auto qx = 0;
+        if(r.x < left / row) r.x = r.x * row / left;
+        else { qx = 1; r.x = (r.x - left / row) * row / (row - left); }
+        r = vec2f(clamp(r.x,0.0f,0.99999994f), clamp(r.y,0.0f,0.99999994f));
+        size /= 2;
+        origin += vec2f(qx,qy) * size;
+        node = n.child[qx+2*qy];
+        if(not node) break;
+    }
+    return _pathguide_uv_to_direction(origin + r * size);
+}
+
+float pathguide_pdf(const PathGuideDirections& dirs, const vec3f& wi) {
+    auto uv = _pathguide_direction_to_uv(wi);
+    auto pdf = 1.0f;
+    auto node = 0;
+    while(true) {
+        auto& n = dirs.nodes[node];
+        auto total = _pathguide_node_sum(n);
+        if(total <= 0) break;
+        auto q = _pathguide_quadrant(uv);
+        pdf *= 4 * n.sum[q].get() / total;
+        node = n.child[q];
+        if(not node) break;
+    }
+    return pdf / (4*pif);
+}
+
+void pathguide_record(PathGuide* guide, int leaf, const vec3f& wi, float radiance_over_pdf) {
+    auto& dirs = guide->leaves[leaf].building;
+    guide->leaves[leaf].samples.add(1);
+    if(not (radiance_over_pdf > 0)) return;
+    auto uv = _pathguide_direction_to_uv(wi);
+    auto node = 0;
+    while(true) {
+        auto q = _pathguide_quadrant(uv);
+        dirs.nodes[node].sum[q].add(radiance_over_pdf);
+        node = dirs.nodes[node].child[q];
+        if(not node) break;
+    }
+}
+
+// build in dst the structure for the subtree of src at src_node, given the radiance in its quadrants
+// (src_node < 0 spreads it uniformly): quadrants holding more than threshold of total are subdivided,
+// so that the structure follows the recorded radiance; dst starts with no radiance
+void _pathguide_refine(const PathGuideDirections& src, int src_node, const array<float,4>& sums, float total, float threshold,
+                       int max_depth, int depth, PathGuideDirections& dst, int dst_node) {
+    for(int q = 0; q < 4; q ++) {
+        if(depth >= max_depth or sums[q] <= total * threshold) continue;
+        auto src_child = (src_node >= 0) ? src.nodes[src_node].child[q] : 0;
+        auto child_sums = array<float,4>();
+        for(int k = 0; k < 4; k ++) child_sums[k] = (src_child) ? src.nodes[src_child].sum[k].get() : sums[q] / 4;
+        auto dst_child = (int)dst.nodes.size();
+        dst.nodes.push_back(PathGuideQuadNode());
+        dst.nodes[dst_node].child[q] = dst_child;
+        _pathguide_refine(src, (src_child) ? src_child : -1, child_sums, total, threshold, max_depth, depth+1, dst, dst_child);
+    }
+}
+
+// split the leaves that recorded many samples, with children inheriting their distributions
+void _pathguide_refine_spatial(PathGuide* guide) {
+    auto threshold = guide->spatial_threshold * sqrt(pow(2.0f,(float)guide->iteration));
+    for(int node = 0; node < guide->nodes.size(); node ++) {
+        if(guide->nodes[node].child[0]) continue;
+        auto leaf = guide->nodes[node].leaf;
+        if(guide->leaves[leaf].samples.get() <= threshold) continue;
+        // new nodes are appended, so they are visited (and possibly split again) later in this loop
+        auto half = guide->leaves[leaf];
+        half.samples = PathGuideAtomic<int>(half.samples.get()/2);
+        guide->leaves[leaf] = half;
+        guide->leaves.push_back(half);
+        for(int k = 0; k < 2; k ++) {
+            auto child = PathGuideSpatialNode();
+            child.axis = (guide->nodes[node].axis+1) % 3;
+            child.leaf = (k == 0) ? leaf : (int)guide->leaves.size()-1;
+            guide->nodes[node].child[k] = guide->nodes.size();
+            guide->nodes.push_back(child);
+        }
+    }
+}
+
+void pathguide_pass_end(PathGuide* guide) {
+    guide->iteration_passes ++;
+    if(guide->iteration_passes < (1 << guide->iteration)) return;
+    _pathguide_refine_spatial(guide);
+    parallel_for(guide->leaves.size(), [&](int start, int end) {
+        for(int i = start; i < end; i ++) {
+            auto& leaf = guide->leaves[i];
+            auto& root = leaf.building.nodes[0];
+            auto sums = array<float,4>{{root.sum[0].get(), root.sum[1].get(), root.sum[2].get(), root.sum[3].get()}};
+            auto refined = PathGuideDirections();
+            _pathguide_refine(leaf.building, 0, sums, _pathguide_node_sum(root), guide->directional_threshold,
+                              guide->directional_max_depth, 1, refined, 0);
+            // sample what was just recorded, and record again from scratch over the refined structure
+            leaf.sampling = leaf.building;
+            leaf.building = refined;
+            leaf.samples = PathGuideAtomic<int>(0);
+        }
+    });
+    guide->iteration ++;
+    guide->iteration_passes = 0;
+}
+
+void pathguide_print_stats(PathGuide* guide) {
+    auto directional_nodes = 0;
+    for(auto& leaf : guide->leaves) directional_nodes += leaf.sampling.nodes.size();
+    printf("Guiding cache: iteration %d, %d spatial leaves, %d directional nodes (%.1f per leaf)\n", guide->iteration,
+           (int)guide->leaves.size(), directional_nodes, directional_nodes / (float)guide->leaves.size());
+}
@@ -0,0 +1,99 @@
+#ifndef _PATHGUIDE_H_
+#define _PATHGUIDE_H_
+
+#include "vmath/vmath.h"
+#include "common/std_utils.h"
+
+///@file igl/pathguide.h Path guiding. @ingroup igl
+///@defgroup pathguide Path guiding
+///@ingroup igl
+///@{
+
+/// value updated atomically by concurrent recording, copyable so that it can be held in vectors
+/// (copies are not atomic, and only happen between passes)
+template<typename T>
+struct PathGuideAtomic {
+    std::atomic<T>      value; ///< value
+
+    /// Value constructor
+    PathGuideAtomic(T v = 0) : value(v) { }
+    /// Copy constructor
+    PathGuideAtomic(const PathGuideAtomic& a) : value(a.value.load()) { }
+    /// Copy assignment
+    PathGuideAtomic& operator=(const PathGuideAtomic& a) { value.store(a.value.load()); return *this; }
+
+    /// atomic increment
+    void add(T v) { auto old = value.load(); while(not value.compare_exchange_weak(old, old+v)) { } }
+    /// current value
+    T get() const { return value.load(); }
+};
+
+/// Directional quadtree node over the cylindrical mapping of the sphere (u = (cos(theta)+1)/2, v = phi/(2 pi))
+struct PathGuideQuadNode {
+    PathGuideAtomic<float>  sum[4]; ///< radiance recorded in each quadrant (x bit from u, y bit from v)
+    int                     child[4] = {0,0,0,0}; ///< child node of each quadrant (0 for leaves)
+};
+
+/// Directional distribution of incident radiance, as a quadtree refined where most radiance was recorded
+struct PathGuideDirections {
+    vector<PathGuideQuadNode>   nodes = vector<PathGuideQuadNode>(1); ///< nodes, root first
+};
+
+/// Spatial binary tree node, split in the middle of its box
+struct PathGuideSpatialNode {
+    int                 axis = 0; ///< split axis
+    int                 child[2] = {0,0}; ///< children below and above the split (0 for leaves)
+    int                 leaf = 0; ///< leaf index (leaves only)
+};
+
+/// Spatial binary tree leaf: the distribution used for sampling, learned in the previous iteration,
+/// and the one being recorded in this iteration
+struct PathGuideLeaf {
+    PathGuideDirections     sampling; ///< distribution to sample
+    PathGuideDirections     building; ///< distribution being recorded
+    PathGuideAtomic<int>    samples; ///< samples recorded in this iteration
+};
+
+/// Path guiding cache (spatial binary tree of directional quadtrees, as in practical path guiding),
+/// trained over iterations of doubling numbers of passes
+struct PathGuide {
+    range3f                         bbox; ///< cubic bounding box of the spatial tree
+    vector<PathGuideSpatialNode>    nodes = vector<PathGuideSpatialNode>(1); ///< spatial nodes, root first
+    vector<PathGuideLeaf>           leaves = vector<PathGuideLeaf>(1); ///< spatial leaves
+
+    int         iteration = 0; ///< current training iteration (lasting 2^iteration passes)
+    int         iteration_passes = 0; ///< passes done in the current iteration
+
+    float       spatial_threshold = 12000; ///< leaves split when recording more than this times sqrt(2^iteration) samples
+    float       directional_threshold = 0.01f; ///< quadtree nodes split when holding more than this fraction of the radiance
+    int         directional_max_depth = 20; ///< maximum quadtree depth
+};
+
+///@name path guiding interface
+///@{
+/// cache covering bbox
+PathGuide* pathguide_init(const range3f& bbox);
+/// frees a cache created by pathguide_init
+void pathguide_free(PathGuide* guide);
+/// leaf of the spatial tree containing p
+int pathguide_leaf(PathGuide* guide, const vec3f& p);
+/// whether the distribution has learned anything to sample
+inline bool pathguide_valid(const PathGuideDirections& dirs) {
+    auto& root = dirs.nodes[0];
+    return root.sum[0].get() + root.sum[1].get() + root.sum[2].get() + root.sum[3].get() > 0;
+}
+/// direction sampled from the distribution
+vec3f pathguide_sample(const PathGuideDirections& dirs, const vec2f& ruv);
+/// solid angle pdf of pathguide_sample
+float pathguide_pdf(const PathGuideDirections& dirs, const vec3f& wi);
+/// records radiance arriving at leaf from direction wi, divided by the pdf wi was sampled with (thread safe)
+void pathguide_record(PathGuide* guide, int leaf, const vec3f& wi, float radiance_over_pdf);
+/// ends a pass, refining the trees and starting to sample what was recorded when an iteration ends
+void pathguide_pass_end(PathGuide* guide);
+/// prints the training iteration and the size of the trees
+void pathguide_print_stats(PathGuide* guide);
+///@}
+
+///@}
+
+#endif
@@ -2,6 +2,145 @@
 
 #include "vmath/random.h"
 #include "intersect.h"
+#include "pathguide.h"
 
 ///@file igl/pathtrace.cpp Pathtracing. @ingroup igl
 
+// path vertex kept to train the guiding cache: the radiance arriving along wi is what later vertices
+// contribute divided by the throughput up to and including this vertex
+struct _PathtraceGuideVertex {
+    int     leaf = 0; ///< guiding cache leaf
+    vec3f   wi = zero3f; ///< sampled direction
+    float   pdf = 0; ///< pdf wi was sampled with
+    float   throughput = 0; ///< mean path throughput after scattering at this vertex
+    float   radiance = 0; ///< mean radiance arriving along wi
+};
+
+// radiance of a path leaving the scene: the background and the envlights, which are not sampled directly
+vec3f _pathtrace_escaped(Scene* scene, const vec3f& d, const PathtraceOptions& opts) {
+    auto c = opts.background;
+    for(auto l : scene->lights->lights) if(is<EnvLight>(l)) c += light_sample_background(l, d);
+    return c;
+}
+
+// direction sampled from the guiding distribution, mirrored above the surface when it falls below it: materials
+// do not transmit, and cells covering several surfaces learn radiance from both sides
+vec3f _pathtrace_guide_sample(const PathGuideDirections& dirs, const frame3f& frame, const vec2f& ruv) {
+    auto wi = pathguide_sample(dirs, ruv);
+    return (dot(wi,frame.z) < 0) ? wi - frame.z * (2*dot(wi,frame.z)) : wi;
+}
+
+// pdf of _pathtrace_guide_sample
+float _pathtrace_guide_pdf(const PathGuideDirections& dirs, const frame3f& frame, const vec3f& wi) {
+    if(dot(wi,frame.z) < 0) return 0;
+    return pathguide_pdf(dirs, wi) + pathguide_pdf(dirs, wi - frame.z * (2*dot(wi,frame.z)));
+}
+
+// radiance along a camera ray; direct lighting is sampled at every vertex and emission only counted on camera
+// rays and after mirror reflections, so surfaces that are both emissive and lights are not counted twice;
+// indirect directions mix brdf and guided sampling (one-sample balance heuristic)
+vec3f _pathtrace_ray(Scene* scene, ray3f ray, const PathtraceOptions& opts, Rng& rng, vector<_PathtraceGuideVertex>& vertices) {
+    auto guide = opts._guide;
+    auto& ll = (opts.cameralights) ? scene->_cameralights : scene->lights;
+    auto c = zero3f;
+    auto throughput = one3f;
+    auto specular = true;
+    vertices.clear();
+
+    // adds the radiance l arriving at the current vertex
+    auto add = [&](const vec3f& l) {
+        auto cl = throughput * l;
+        c += cl;
+        for(auto& v : vertices) v.radiance += mean_component(cl) / v.throughput;
+    };
+
+    for(int depth = 0; ; depth ++) {
+        // intersect
+        intersection3f intersection;
+        if(not intersect_scene_first(scene,ray,intersection)) { add(_pathtrace_escaped(scene, ray.d, opts)); break; }
+
+        // set up variables
+        auto frame = intersection.frame;
+        auto wo = -ray.d;
+        if(opts.doublesided) frame = faceforward(frame,ray.d);
+        frame = material_shading_frame(intersection.material, frame, intersection.texcoord);
+        auto brdf = material_shading_textures(intersection.material, intersection.texcoord);
+
+        // compute ambient and emission
+        if(depth == 0) add(opts.ambient * material_diffuse_albedo(brdf));
+        if(specular) add(material_emission(brdf, frame, wo));
+
+        // compute direct
+        for(auto l : ll->lights) {
+            if(is<EnvLight>(l)) continue;
+            auto ss = rand_light_shadow_sample(l, frame.o, rng.next_float(), rng.next_float());
+            if(ss.radiance == zero3f) continue;
+            auto cl = ss.radiance * material_brdfcos(brdf,frame,ss.dir,wo) / ss.pdf;
+            if(cl == zero3f) continue;
+            if(opts.shadows and intersect_scene_any(scene,ray3f::segment(frame.o,frame.o+ss.dir*ss.dist))) continue;
+            add(cl);
+        }
+        if(depth >= opts.max_depth) { delete brdf; break; }
+
+        // continue along the mirror reflection or an indirect direction, picked at random when both apply
+        auto refl = (opts.reflections) ? material_sample_reflection(brdf, frame, wo) : BrdfSample();
+        auto mirror_prob = (refl.brdfcos == zero3f) ? 0.0f : ((opts.indirect) ? min(0.5f, mean_component(refl.brdfcos)) : 1.0f);
+        if(mirror_prob > 0 and rng.next_float() < mirror_prob) {
+            throughput *= refl.brdfcos / mirror_prob;
+            ray = ray3f(frame.o,refl.wi);
+            specular = true;
+            delete brdf;
+            continue;
+        }
+        if(not opts.indirect) { delete brdf; break; }
+
+        auto leaf = (guide) ? pathguide_leaf(guide, frame.o) : 0;
+        auto guided = guide and pathguide_valid(guide->leaves[leaf].sampling);
+        auto guide_prob = (guided) ? opts.guiding_fraction : 0.0f;
+        auto wi = zero3f;
+        if(guided and rng.next_float() < guide_prob) wi = _pathtrace_guide_sample(guide->leaves[leaf].sampling, frame, rng.next_vec2f());
+        else wi = material_sample_brdfcos(brdf, frame, wo, rng.next_vec2f(), 0).wi;
+        auto pdf = (1-guide_prob) * material_sample_brdfcos_pdf(brdf, frame, wo, wi);
+        if(guided) pdf += guide_prob * _pathtrace_guide_pdf(guide->leaves[leaf].sampling, frame, wi);
+        auto brdfcos = material_brdfcos(brdf, frame, wi, wo);
+        delete brdf;
+        if(pdf <= 0 or brdfcos == zero3f) break;
+        throughput *= brdfcos / (pdf * (1-mirror_prob));
+        if(guide) {
+            auto v = _PathtraceGuideVertex();
+            v.leaf = leaf; v.wi = wi; v.pdf = pdf; v.throughput = mean_component(throughput);
+            if(v.throughput > 0) vertices.push_back(v);
+        }
+        ray = ray3f(frame.o,wi);
+        specular = false;
+    }
+
+    // train the cache
+    for(auto& v : vertices) pathguide_record(guide, v.leaf, v.wi, v.radiance / v.pdf);
+
+    return c;
+}
+
+void pathtrace_scene_progressive(ImageBuffer& buffer, Scene* scene, PathtraceOptions& opts) {
+    if(opts.guiding and not opts._guide) opts._guide = pathguide_init(intersect_scene_bounds(scene));
+    auto w = buffer.width();
+    auto h = buffer.height();
+    auto tile = image_crop_tile(opts.crop, w, h);
+
+    // pixels get their own rng, seeded from the pixel and its samples, so images do not depend on threading or crops
+    parallel_for_dynamic(size(tile).y, [&](int row, int thread) {
+        auto j = tile.min.y + row;
+        auto rng = Rng();
+        auto vertices = vector<_PathtraceGuideVertex>();
+        for(int i = tile.min.x; i < tile.max.x; i ++) {
+            rng.seed(rng_seed_hash(j*w+i, buffer.samples.at(i,h-1-j)));
+            auto u = (i + rng.next_float()) / w;
+            auto v = (j + rng.next_float()) / h;
+            auto ray = camera_ray(scene->camera,vec2f(u,v));
+            buffer.accum.at(i,h-1-j) += _pathtrace_ray(scene, ray, opts, rng, vertices);
+            buffer.samples.at(i,h-1-j) += 1;
+        }
+    });
+
+    if(opts._guide) pathguide_pass_end(opts._guide);
+}
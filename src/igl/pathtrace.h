@@ -3,6 +3,8 @@
 
 #include "scene.h"
 
+struct PathGuide;
+
 ///@file igl/pathtrace.h Pathtracing. @ingroup igl
 ///@defgroup pathtrace Pathtracing
 ///@ingroup igl
@@ -34,9 +36,24 @@ struct PathtraceOptions : Node {
     float image_scale = 1; ///< scale vaalue for image pixels
     float image_gamma = 1; ///< gamma value for image pixels
     
+    range2i crop = range2i(); ///< pixels to render in image coordinates (x right, y down, max excluded; invalid for all)
+    
+    bool guiding = false; ///< whether to guide indirect samples with a cache learned over passes
+    float guiding_fraction = 0.5f; ///< fraction of indirect samples drawn from the cache instead of the brdf
+    
     Rng rng; ///< random number generator
+    
+    PathGuide* _guide = nullptr; ///< guiding cache, created by the first guided pass and trained by every pass
 };
 
+///@name pathtrace interface
+///@{
+
+/// adds one sample to the pixels in opts.crop (all if not valid), with rows rendered in parallel and the same
+/// samples as a full render; with guiding, trains the cache (from the crop only, so guided crops do not match)
+void pathtrace_scene_progressive(ImageBuffer& buffer, Scene* scene, PathtraceOptions& opts);
+
+///@}
 
 ///@}
 
@@ -0,0 +1,269 @@
+#include "photonmap.h"
+
+#include "vmath/random.h"
+#include "intersect.h"
+
+#include <algorithm>
+
+///@file igl/photonmap.cpp Photon mapping. @ingroup igl
+
+// photons are emitted in chunks, each with its own rng, so the map does not depend on threading
+const int _photonmap_chunk_size = 4096;
+
+// bounding sphere of a mirror primitive; caustic paths start with a mirror reflection, so photons are only
+// emitted towards these (as projection maps do)
+struct _PhotonTarget {
+    vec3f       center = zero3f; ///< sphere center
+    float       radius = 0; ///< sphere radius
+};
+
+// cone of directions from a point towards a target
+struct _PhotonCone {
+    vec3f       axis = z3f; ///< cone axis
+    float       cos_max = -1; ///< cosine of the cone half-angle (-1 for the whole sphere)
+    float       solid_angle = 4*pif; ///< cone solid angle
+};
+
+// bounding spheres of the primitives with a reflection color
+vector<_PhotonTarget> _photonmap_targets(Scene* scene) {
+    auto targets = vector<_PhotonTarget>();
+    for(auto prim : scene->prims->prims) {
+        if(not is<Phong>(prim->material) or cast<Phong>(prim->material)->reflection == zero3f) continue;
+        auto bbox = intersect_primitive_bounds(prim);
+        auto target = _PhotonTarget();
+        target.center = center(bbox);
+        target.radius = length(size(bbox))/2;
+        targets.push_back(target);
+    }
+    return targets;
+}
+
+// cones from o towards all targets, returning their total solid angle
+float _photonmap_cones(const vec3f& o, const vector<_PhotonTarget>& targets, vector<_PhotonCone>& cones) {
+    cones.resize(targets.size());
+    auto total = 0.0f;
+    for(auto i : range(targets.size())) {
+        auto d = targets[i].center - o;
+        auto dist = length(d);
+        cones[i].axis = (dist > 0) ? d / dist : z3f;
+        cones[i].cos_max = (dist > targets[i].radius) ? sqrt(1 - (targets[i].radius/dist)*(targets[i].radius/dist)) : -1;
+        cones[i].solid_angle = 2*pif*(1-cones[i].cos_max);
+        total += cones[i].solid_angle;
+    }
+    return total;
+}
+
+// uniform direction in a cone picked by solid angle; weight is the inverse of the pdf of the mixture of cones,
+// which counts the cones containing the direction so that overlaps are not counted twice
+vec3f _photonmap_sample_cones(const vector<_PhotonCone>& cones, float total_solid_angle, Rng& rng, float& weight) {
+    auto r = rng.next_float() * total_solid_angle;
+    auto k = 0;
+    while(k < (int)cones.size()-1 and r >= cones[k].solid_angle) { r -= cones[k].solid_angle; k ++; }
+    auto f = frame3f();
+    f.z = cones[k].axis;
+    f.y = (abs(f.z.z) < 0.9f) ? z3f : x3f;
+    f = orthonormalize(f);
+    auto cos_theta = 1 - rng.next_float()*(1-cones[k].cos_max);
+    auto sin_theta = sqrt(max(0.0f,1-cos_theta*cos_theta));
+    auto phi = 2*pif*rng.next_float();
+    auto d = transform_direction(f, vec3f(cos(phi)*sin_theta, sin(phi)*sin_theta, cos_theta));
+    auto count = 0;
+    for(auto& cone : cones) if(dot(d,cone.axis) >= cone.cos_max) count ++;
+    weight = total_solid_angle / max(count,1);
+    return d;
+}
+
+// flux of a light towards the targets, estimated from its center (zero for lights that do not emit photons)
+float _photonmap_light_power(Light* light, const vector<_PhotonTarget>& targets, vector<_PhotonCone>& cones) {
+    if(is<PointLight>(light)) return mean_component(cast<PointLight>(light)->intensity) * _photonmap_cones(light->frame.o, targets, cones);
+    else if(is<AreaLight>(light)) {
+        auto quad = cast<Quad>(cast<AreaLight>(light)->shape);
+        return mean_component(cast<AreaLight>(light)->intensity) * quad->width * quad->height * _photonmap_cones(light->frame.o, targets, cones);
+    }
+    else return 0;
+}
+
+// photon ray leaving a light towards the targets, with the flux it carries for one emitted photon:
+// from the center of point lights, from a uniform point of the quad of area lights (emitting along z, as in
+// light_shadow_sample); returns false if the direction is not emitted
+bool _photonmap_light_ray(Light* light, const vector<_PhotonTarget>& targets, vector<_PhotonCone>& cones, Rng& rng, ray3f& ray, vec3f& power) {
+    auto weight = 0.0f;
+    if(is<PointLight>(light)) {
+        auto total = _photonmap_cones(light->frame.o, targets, cones);
+        auto d = _photonmap_sample_cones(cones, total, rng, weight);
+        ray = ray3f(light->frame.o, d);
+        power = cast<PointLight>(light)->intensity * weight;
+        return true;
+    }
+    else if(is<AreaLight>(light)) {
+        auto quad = cast<Quad>(cast<AreaLight>(light)->shape);
+        auto o = transform_point(light->frame, vec3f((rng.next_float()-0.5f)*quad->width, (rng.next_float()-0.5f)*quad->height, 0));
+        auto total = _photonmap_cones(o, targets, cones);
+        auto d = _photonmap_sample_cones(cones, total, rng, weight);
+        auto cos = dot(d, light->frame.z);
+        if(cos <= 0) return false;
+        ray = ray3f(o, d);
+        power = cast<AreaLight>(light)->intensity * (cos * quad->width * quad->height * weight);
+        return true;
+    }
+    else { NOT_IMPLEMENTED_ERROR(); return false; }
+}
+
+// follow a photon through mirror reflections, storing it at every diffuse surface reached after the first one
+void _photonmap_trace(Scene* scene, ray3f ray, vec3f power, int max_depth, bool doublesided, vector<Photon>& photons) {
+    for(int depth = 0; depth <= max_depth; depth ++) {
+        intersection3f intersection;
+        if(not intersect_scene_first(scene,ray,intersection)) return;
+        auto frame = intersection.frame;
+        if(doublesided) frame = faceforward(frame,ray.d);
+        auto wo = -ray.d;
+        auto brdf = material_shading_textures(intersection.material, intersection.texcoord);
+        if(depth > 0 and not (material_diffuse_albedo(brdf) == zero3f)) {
+            auto photon = Photon();
+            photon.pos = frame.o;
+            photon.power = power;
+            photon.wi = wo;
+            photons.push_back(photon);
+        }
+        auto bs = material_sample_reflection(brdf, frame, wo);
+        delete brdf;
+        if(bs.brdfcos == zero3f) return;
+        power *= bs.brdfcos;
+        ray = ray3f(frame.o,bs.wi);
+    }
+}
+
+// balance photons in [start,end) around the median of the axis of largest extent; ranges reached at depth
+// split_depth are left to the caller in deferred, so that they can be balanced in parallel
+void _photonmap_balance(vector<Photon>& photons, vector<PhotonNode>& nodes, int start, int end, int depth, int split_depth, vector<vec2i>& deferred) {
+    if(start >= end) return;
+    if(depth == split_depth) { deferred.push_back(vec2i(start,end)); return; }
+    auto bbox = range3f();
+    for(int i = start; i < end; i ++) bbox = runion(bbox,photons[i].pos);
+    auto extent = size(bbox);
+    auto axis = (extent.x >= extent.y and extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+    auto mid = (start+end)/2;
+    std::nth_element(photons.begin()+start, photons.begin()+mid, photons.begin()+end,
+                     [axis](const Photon& a, const Photon& b) { return a.pos[axis] < b.pos[axis]; });
+    nodes[mid].pos = photons[mid].pos;
+    nodes[mid].axis = axis;
+    _photonmap_balance(photons, nodes, start, mid, depth+1, split_depth, deferred);
+    _photonmap_balance(photons, nodes, mid+1, end, depth+1, split_depth, deferred);
+}
+
+// nearest photons to p in the subtree [start,end), kept as a max-heap on squared distance of at most nearest
+// entries; max_dist2 shrinks to the farthest kept photon once the heap is full
+void _photonmap_nearest(const vector<PhotonNode>& nodes, const vec3f& p, int start, int end, int nearest, float& max_dist2, vector<pair<float,int>>& heap) {
+    while(start < end) {
+        auto mid = (start+end)/2;
+        auto& node = nodes[mid];
+        auto d = p[node.axis] - node.pos[node.axis];
+        // visit the side containing p first, then the other one only if the splitting plane is close enough
+        auto near_start = (d < 0) ? start : mid+1, near_end = (d < 0) ? mid : end;
+        auto far_start = (d < 0) ? mid+1 : start, far_end = (d < 0) ? end : mid;
+        _photonmap_nearest(nodes, p, near_start, near_end, nearest, max_dist2, heap);
+        auto dist2 = lengthSqr(node.pos - p);
+        if(dist2 < max_dist2) {
+            if(heap.size() == nearest) { std::pop_heap(heap.begin(), heap.end()); heap.pop_back(); }
+            heap.push_back({dist2,mid});
+            std::push_heap(heap.begin(), heap.end());
+            if(heap.size() == nearest) max_dist2 = heap.front().first;
+        }
+        if(d*d >= max_dist2) return;
+        start = far_start; end = far_end;
+    }
+}
+
+PhotonMap* photonmap_caustics_build(Scene* scene, int photons, float radius, int nearest, int max_depth, bool doublesided) {
+    auto t = timer();
+    auto map = new PhotonMap();
+    map->radius = radius;
+    map->nearest = nearest;
+
+    // split photons among lights by the flux they send towards the targets (from their centers),
+    // each photon carrying an equal share of its light
+    auto targets = _photonmap_targets(scene);
+    auto lights = vector<Light*>();
+    auto light_power = vector<float>();
+    auto total_power = 0.0f;
+    auto cones = vector<_PhotonCone>();
+    for(auto light : scene->lights->lights) {
+        auto power = (targets.empty()) ? 0 : _photonmap_light_power(light, targets, cones);
+        if(power <= 0) continue;
+        lights.push_back(light);
+        light_power.push_back(power);
+        total_power += power;
+    }
+    auto light_end = vector<int>();
+    for(auto l : range(lights.size())) {
+        auto count = (int)round(photons * light_power[l] / total_power);
+        light_end.push_back(((light_end.empty()) ? 0 : light_end.back()) + count);
+    }
+    map->emitted = (light_end.empty()) ? 0 : light_end.back();
+
+    // emit and trace in parallel chunks
+    auto nchunks = (map->emitted + _photonmap_chunk_size - 1) / _photonmap_chunk_size;
+    auto chunk_photons = vector<vector<Photon>>(nchunks);
+    parallel_for_dynamic(nchunks, [&](int chunk, int thread) {
+        auto rng = Rng();
+        rng.seed(chunk+1);
+        auto cones = vector<_PhotonCone>();
+        auto start = chunk*_photonmap_chunk_size, end = min(start+_photonmap_chunk_size, map->emitted);
+        auto l = (int)(std::upper_bound(light_end.begin(), light_end.end(), start) - light_end.begin());
+        for(int i = start; i < end; i ++) {
+            while(i >= light_end[l]) l ++;
+            auto count = light_end[l] - ((l) ? light_end[l-1] : 0);
+            auto ray = ray3f(); auto power = zero3f;
+            if(not _photonmap_light_ray(lights[l], targets, cones, rng, ray, power)) continue;
+            _photonmap_trace(scene, ray, power / count, max_depth, doublesided, chunk_photons[chunk]);
+        }
+    });
+    for(auto& cp : chunk_photons) map->photons.insert(map->photons.end(), cp.begin(), cp.end());
+
+    // balance the top of the tree serially, then its subtrees in parallel
+    map->_nodes.resize(map->photons.size());
+    auto split_depth = 0;
+    while((1 << split_depth) < parallel_nthreads()*4) split_depth ++;
+    auto deferred = vector<vec2i>();
+    _photonmap_balance(map->photons, map->_nodes, 0, map->photons.size(), 0, split_depth, deferred);
+    parallel_for_dynamic(deferred.size(), [&](int i, int thread) {
+        auto unused = vector<vec2i>();
+        _photonmap_balance(map->photons, map->_nodes, deferred[i].x, deferred[i].y, 0, -1, unused);
+    });
+
+    map->build_time = t.elapsed();
+    return map;
+}
+
+vec3f _photonmap_caustics_radiance(PhotonMap* map, const frame3f& frame, const vec3f& wo, Material* brdf) {
+    auto heap = vector<pair<float,int>>();
+    heap.reserve(map->nearest);
+    auto max_dist2 = map->radius*map->radius;
+    _photonmap_nearest(map->_nodes, frame.o, 0, map->_nodes.size(), map->nearest, max_dist2, heap);
+
+    // radiance estimate over the disc holding the photons (the gather radius until enough photons are found)
+    auto c = zero3f;
+    for(auto& h : heap) {
+        auto& photon = map->photons[h.second];
+        auto cos = dot(photon.wi,frame.z);
+        if(cos <= 0) continue;
+        c += photon.power * material_brdfcos(brdf, frame, photon.wi, wo) / cos;
+    }
+    if(not heap.empty()) c /= pif * max_dist2;
+    return c;
+}
+
+// every thread shading a hit would update the same counters, so gathers are only timed with stats
+vec3f photonmap_caustics_radiance(PhotonMap* map, const frame3f& frame, const vec3f& wo, Material* brdf) {
+    if(not map->stats) return _photonmap_caustics_radiance(map, frame, wo, brdf);
+    auto start_time = timer::_now();
+    auto c = _photonmap_caustics_radiance(map, frame, wo, brdf);
+    map->_gather_count ++;
+    map->_gather_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(timer::_now()-start_time).count();
+    return c;
+}
+
+void photonmap_print_stats(PhotonMap* map) {
+    printf("Caustic photons: %d stored of %d emitted, build time: %.3fs\n", (int)map->photons.size(), map->emitted, map->build_time);
+    if(map->stats) printf("Caustic gathers: %ld, gather time: %.3fs (summed over threads)\n", (long)map->_gather_count, map->_gather_nanoseconds / 1e9);
+}
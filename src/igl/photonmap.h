@@ -0,0 +1,53 @@
+#ifndef _PHOTONMAP_H_
+#define _PHOTONMAP_H_
+
+#include "scene.h"
+
+///@file igl/photonmap.h Photon mapping. @ingroup igl
+///@defgroup photonmap Photon mapping
+///@ingroup igl
+///@{
+
+/// Photon stored where a light path reached a diffuse surface
+struct Photon {
+    vec3f           pos = zero3f; ///< position
+    vec3f           power = zero3f; ///< flux carried by the photon
+    vec3f           wi = zero3f; ///< direction the photon came from
+};
+
+/// Photon kd-tree node: position and split axis only, so that lookups touch 16 bytes per visited photon
+struct PhotonNode {
+    vec3f           pos = zero3f; ///< photon position
+    int             axis = 0; ///< split axis
+};
+
+/// Caustic photon map: photons that reached a diffuse surface after one or more mirror reflections,
+/// stored as a balanced kd-tree in flat arrays (the median of a range is its node, the halves around it its subtrees)
+struct PhotonMap {
+    vector<Photon>      photons; ///< photons in kd-tree order
+    vector<PhotonNode>  _nodes; ///< kd-tree nodes, parallel to photons
+
+    int                 emitted = 0; ///< number of photons emitted from the lights
+    float               radius = 0.1f; ///< maximum gather radius
+    int                 nearest = 50; ///< number of photons used for density estimation
+
+    bool                stats = false; ///< whether to count and time density estimates (shared counters, so off by default)
+    float               build_time = 0; ///< time spent emitting photons and building the kd-tree
+    std::atomic<long>   _gather_count{0}; ///< number of density estimates so far
+    std::atomic<long>   _gather_nanoseconds{0}; ///< time spent in density estimates so far
+};
+
+///@name photon map interface
+///@{
+/// emits photons from point and area lights in parallel, keeps those reaching diffuse surfaces through mirror
+/// reflections (up to max_depth) and builds their kd-tree; other lights do not produce caustics
+PhotonMap* photonmap_caustics_build(Scene* scene, int photons, float radius, int nearest, int max_depth, bool doublesided);
+/// caustic radiance leaving frame.o towards wo, from the density of the nearest photons (thread safe)
+vec3f photonmap_caustics_radiance(PhotonMap* map, const frame3f& frame, const vec3f& wo, Material* brdf);
+/// prints the photon counts, the build time and, with stats, the time spent in density estimates
+void photonmap_print_stats(PhotonMap* map);
+///@}
+
+///@}
+
+#endif
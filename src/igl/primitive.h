@@ -36,6 +36,7 @@ struct Surface : Primitive {
     REGISTER_FAST_RTTI(Primitive,Surface,1)
     
     Shape*               shape = nullptr; ///< shape
+    Shape*               _lod = nullptr; ///< level of detail rendered instead of shape (see scene_lods_select)
 };
 
 /// Surface Transformed with aributrary and animated transformations
@@ -43,6 +44,7 @@ struct TransformedSurface : Primitive {
     REGISTER_FAST_RTTI(Primitive,TransformedSurface,2)
     
     Shape*              shape = nullptr; ///< shape
+    Shape*              _lod = nullptr; ///< level of detail rendered instead of shape (see scene_lods_select)
     
     frame3f             pivot = identity_frame3f; ///< transformation center and orientation
     
@@ -54,6 +56,14 @@ struct TransformedSurface : Primitive {
     KeyframedValue*     anim_scale = nullptr; ///< scaling keyframed animation
 };
 
+///@name level of detail support
+///@{
+/// shape rendered for a surface: its selected level of detail, or the shape itself
+inline Shape* surface_rendered_shape(Surface* surface) { return (surface->_lod) ? surface->_lod : surface->shape; }
+/// shape rendered for a transformed surface: its selected level of detail, or the shape itself
+inline Shape* transformed_rendered_shape(TransformedSurface* transformed) { return (transformed->_lod) ? transformed->_lod : transformed->shape; }
+///@}
+
 ///@name TransformedShape animation support
 ///@{
 inline bool transformed_animated(TransformedSurface* transformed) {
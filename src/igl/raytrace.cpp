@@ -2,9 +2,14 @@
 
 #include "vmath/random.h"
 #include "intersect.h"
+#include "photonmap.h"
 
 ///@file igl/raytrace.cpp Raytracing. @ingroup igl
 
+// option flags resolved at compile time in the kernels below
+enum { _raytrace_doublesided = 1, _raytrace_shadows = 2, _raytrace_reflections = 4, _raytrace_cameralights = 8, _raytrace_envlight_sh = 16, _raytrace_caustics = 32 };
+
+template<int flags>
 vec3f _raytrace_scene_ray(Scene* scene, const ray3f& ray, const RaytraceOptions& opts, int depth) {
     // intersect
     intersection3f intersection;
@@ -17,7 +22,7 @@ vec3f _raytrace_scene_ray(Scene* scene, const ray3f& ray, const RaytraceOptions&
     auto material = intersection.material;
     
     // shading frame
-    if(opts.doublesided) frame = faceforward(frame,ray.d);
+    if(flags & _raytrace_doublesided) frame = faceforward(frame,ray.d);
     frame = material_shading_frame(material, frame, texcoord);
 
     // brdf
@@ -31,24 +36,28 @@ vec3f _raytrace_scene_ray(Scene* scene, const ray3f& ray, const RaytraceOptions&
     c += material_emission(brdf, frame, wo);
     
     // compute direct
-    auto& ll = (opts.cameralights) ? scene->_cameralights : scene->lights;
+    auto& ll = (flags & _raytrace_cameralights) ? scene->_cameralights : scene->lights;
     for(auto l : ll->lights) {
+        if((flags & _raytrace_envlight_sh) and is<EnvLight>(l)) { c += raytrace_envlight_sh(scene, cast<EnvLight>(l), frame, brdf, flags & _raytrace_shadows); continue; }
         auto ss = light_shadow_sample(l,frame.o);
         auto wi = ss.dir;
         if(ss.radiance == zero3f) continue;
         vec3f cl = ss.radiance * material_brdfcos(brdf,frame,wi,wo) / ss.pdf;
         if(cl == zero3f) continue;
-        if(opts.shadows) {
+        if(flags & _raytrace_shadows) {
             if(not intersect_scene_any(scene,ray3f::segment(frame.o,frame.o+ss.dir*ss.dist))) c += cl;
         } else c += cl;
     }
     
+    // compute caustics
+    if(flags & _raytrace_caustics) c += photonmap_caustics_radiance(scene->_caustics, frame, wo, brdf);
+    
     // recursively compute reflections
-    if(opts.reflections and depth < opts.max_depth) {
+    if((flags & _raytrace_reflections) and depth < opts.max_depth) {
         auto bs = material_sample_reflection(brdf, frame, wo);
         if(not (bs.brdfcos == zero3f)) {
             auto refl_ray = ray3f(frame.o,bs.wi);
-            c += _raytrace_scene_ray(scene, refl_ray, opts, depth+1) * bs.brdfcos;
+            c += _raytrace_scene_ray<flags>(scene, refl_ray, opts, depth+1) * bs.brdfcos;
         }
     }
     
@@ -59,19 +68,58 @@ vec3f _raytrace_scene_ray(Scene* scene, const ray3f& ray, const RaytraceOptions&
     return c;
 }
 
+// kernel specializations, indexed by option flags
+using _raytrace_kernel = vec3f (*)(Scene*, const ray3f&, const RaytraceOptions&, int);
+template<int n>
+struct _raytrace_kernel_table {
+    static void init(_raytrace_kernel* kernels) { kernels[n-1] = _raytrace_scene_ray<n-1>; _raytrace_kernel_table<n-1>::init(kernels); }
+};
+template<>
+struct _raytrace_kernel_table<0> {
+    static void init(_raytrace_kernel* kernels) { }
+};
+struct _RaytraceKernels {
+    _raytrace_kernel kernels[64];
+    _RaytraceKernels() { _raytrace_kernel_table<64>::init(kernels); }
+};
+const _RaytraceKernels _raytrace_kernels;
+
+// select the kernel matching the options and the scene
+_raytrace_kernel _raytrace_scene_kernel(Scene* scene, const RaytraceOptions& opts) {
+    return _raytrace_kernels.kernels[((opts.doublesided) ? _raytrace_doublesided : 0) | ((opts.shadows) ? _raytrace_shadows : 0) |
+                                     ((opts.reflections) ? _raytrace_reflections : 0) | ((opts.cameralights) ? _raytrace_cameralights : 0) |
+                                     ((opts.envlight_sh) ? _raytrace_envlight_sh : 0) | ((scene->_caustics) ? _raytrace_caustics : 0)];
+}
+
+vec3f raytrace_envlight_sh(Scene* scene, EnvLight* env, const frame3f& frame, Material* brdf, bool shadows) {
+    DEBUG_ERROR_IF_NOT(not env->_sh_irradiance.empty(), "envlight irradiance not initialized (see sample_lights_init)");
+    auto occluded = false;
+    if(shadows) {
+        auto dir = transform_direction(env->frame, env->_sh_dominant_dir);
+        if(dot(dir,frame.z) > 0) occluded = intersect_scene_any(scene, ray3f(frame.o,dir));
+    }
+    return material_diffuse_albedo(brdf) * envlight_sh_irradiance(env, frame.z, occluded) / pif;
+}
+
 void raytrace_scene_progressive(ImageBuffer& buffer, Scene* scene, const RaytraceOptions& opts) {
+    raytrace_scene_tile(buffer, scene, scene->camera, image_crop_tile(opts.crop,buffer.width(),buffer.height()), opts);
+}
+
+void raytrace_scene_tile(ImageBuffer& buffer, Scene* scene, Camera* camera, const range2i& tile, const RaytraceOptions& opts) {
     auto w = buffer.width();
     auto h = buffer.height();
     
+    auto kernel = _raytrace_scene_kernel(scene, opts);
+    
     int s2 = max(1,(int)sqrt(opts.samples));
-    for(int j = 0; j < h; j ++) {
-        for(int i = 0; i < w; i ++) {
-            auto cs = buffer.samples.at(i,h-1-j);
+    for(int j = tile.min.y; j < tile.max.y; j ++) {
+        for(int i = tile.min.x; i < tile.max.x; i ++) {
+            auto cs = buffer.samples.at(i,h-1-j) % (s2*s2); // reprojected pixels may hold more samples than the pattern
             auto ii = cs % s2; auto jj = cs / s2;
             float u = (i+(ii+0.5)/s2)/w;
             float v = (j+(jj+0.5)/s2)/h;
-            ray3f ray = camera_ray(scene->camera,vec2f(u,v));
-            buffer.accum.at(i,h-1-j) += _raytrace_scene_ray(scene,ray,opts,0);
+            ray3f ray = camera_ray(camera,vec2f(u,v));
+            buffer.accum.at(i,h-1-j) += kernel(scene,ray,opts,0);
             buffer.samples.at(i,h-1-j) += 1;
         }
     }
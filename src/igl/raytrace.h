@@ -26,16 +26,28 @@ struct RaytraceOptions : Node {
     
     bool shadows = true; ///< whether to compute shadows
     bool reflections = true; ///< whether to compute reflections
+    bool envlight_sh = false; ///< fast diffuse envlights: prefiltered irradiance and one visibility ray instead of shadow samples
     
     int max_depth = 4; ///< maximum ray recursion for reflections
     
+    range2i crop = range2i(); ///< pixels to render in image coordinates (x right, y down, max excluded; invalid for all)
+    
+    int caustics_photons = 0; ///< photons emitted for the caustic photon map (0: off)
+    float caustics_radius = 0.1f; ///< maximum caustic gather radius
+    int caustics_nearest = 50; ///< photons used for caustic density estimation
+    
     Rng rng; ///< random number generator
 };
 
 ///@name raytrace interface
 ///@{
 
+/// adds one sample to the pixels in opts.crop (all if not valid), with the same samples as a full render
 void raytrace_scene_progressive(ImageBuffer& buffer, Scene* scene, const RaytraceOptions& opts);
+/// diffuse light from an envlight using its prefiltered irradiance, with (if shadows) one visibility ray towards its dominant direction
+vec3f raytrace_envlight_sh(Scene* scene, EnvLight* env, const frame3f& frame, Material* brdf, bool shadows);
+/// adds one sample to the pixels of tile seen from camera (tiles can be rendered concurrently)
+void raytrace_scene_tile(ImageBuffer& buffer, Scene* scene, Camera* camera, const range2i& tile, const RaytraceOptions& opts);
 
 ///@}
 
@@ -1,3 +1,174 @@
 #include "scene.h"
 
+#include <cstring>
+
 ///@file igl/scene.cpp Scene. @ingroup igl
+
+// references to the shapes and textures of a scene, rewritten when merging duplicates
+struct _DeduplicateSlots {
+    vector<Shape**>     shapes;
+    vector<Texture**>   textures;
+};
+
+void _deduplicate_collect(Texture*& texture, _DeduplicateSlots& slots) {
+    if(texture) slots.textures.push_back(&texture);
+}
+
+void _deduplicate_collect(Shape*& shape, _DeduplicateSlots& slots) {
+    if(not shape) return;
+    slots.shapes.push_back(&shape);
+    if(is<TesselationOverride>(shape)) _deduplicate_collect(cast<TesselationOverride>(shape)->shape, slots);
+    else if(is<DisplacedShape>(shape)) {
+        _deduplicate_collect(cast<DisplacedShape>(shape)->shape, slots);
+        _deduplicate_collect(cast<DisplacedShape>(shape)->displacement, slots);
+    }
+}
+
+void _deduplicate_collect(Material* material, _DeduplicateSlots& slots) {
+    if(not material) return;
+    _deduplicate_collect(material->normal_texture, slots);
+    if(is<Lambert>(material)) _deduplicate_collect(cast<Lambert>(material)->diffuse_texture, slots);
+    else if(is<Phong>(material)) {
+        auto phong = cast<Phong>(material);
+        _deduplicate_collect(phong->diffuse_texture, slots);
+        _deduplicate_collect(phong->specular_texture, slots);
+        _deduplicate_collect(phong->exponent_texture, slots);
+        _deduplicate_collect(phong->reflection_texture, slots);
+    }
+    else if(is<LambertEmission>(material)) {
+        _deduplicate_collect(cast<LambertEmission>(material)->diffuse_texture, slots);
+        _deduplicate_collect(cast<LambertEmission>(material)->emission_texture, slots);
+    }
+}
+
+// buffers compared when merging shapes, empty for shapes that are not merged
+template<typename T>
+void _deduplicate_buffer(vector<pair<const void*,size_t>>& buffers, const vector<T>& buffer) {
+    buffers.push_back({buffer.data(), buffer.size()*sizeof(T)});
+}
+
+vector<pair<const void*,size_t>> _deduplicate_buffers(Shape* shape) {
+    auto buffers = vector<pair<const void*,size_t>>();
+    if(is<TriangleMesh>(shape)) {
+        auto mesh = cast<TriangleMesh>(shape);
+        _deduplicate_buffer(buffers, mesh->pos);
+        _deduplicate_buffer(buffers, mesh->norm);
+        _deduplicate_buffer(buffers, mesh->texcoord);
+        _deduplicate_buffer(buffers, mesh->triangle);
+    }
+    else if(is<Mesh>(shape)) {
+        auto mesh = cast<Mesh>(shape);
+        _deduplicate_buffer(buffers, mesh->pos);
+        _deduplicate_buffer(buffers, mesh->norm);
+        _deduplicate_buffer(buffers, mesh->texcoord);
+        _deduplicate_buffer(buffers, mesh->triangle);
+        _deduplicate_buffer(buffers, mesh->quad);
+    }
+    else if(is<FaceMesh>(shape)) {
+        auto mesh = cast<FaceMesh>(shape);
+        _deduplicate_buffer(buffers, mesh->pos);
+        _deduplicate_buffer(buffers, mesh->norm);
+        _deduplicate_buffer(buffers, mesh->texcoord);
+        _deduplicate_buffer(buffers, mesh->vertex);
+        _deduplicate_buffer(buffers, mesh->triangle);
+        _deduplicate_buffer(buffers, mesh->quad);
+    }
+    return buffers;
+}
+
+// FNV-1a
+unsigned long long _deduplicate_hash(unsigned long long hash, const void* data, size_t size) {
+    auto bytes = (const unsigned char*)data;
+    for(size_t i = 0; i < size; i ++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+// shapes are merged only if they also build the same accelerator
+bool _deduplicate_same_settings(Shape* a, Shape* b) {
+    return a->_tid == b->_tid and
+           a->intersect_accelerator_use == b->intersect_accelerator_use and
+           a->intersect_accelerator_spatial_splits == b->intersect_accelerator_spatial_splits and
+           a->intersect_accelerator_linear == b->intersect_accelerator_linear and
+           a->intersect_accelerator_treelet_passes == b->intersect_accelerator_treelet_passes;
+}
+
+bool _deduplicate_same_buffers(const vector<pair<const void*,size_t>>& a, const vector<pair<const void*,size_t>>& b) {
+    if(a.size() != b.size()) return false;
+    for(int i = 0; i < a.size(); i ++) {
+        if(a[i].second != b[i].second) return false;
+        if(a[i].second and memcmp(a[i].first, b[i].first, a[i].second)) return false;
+    }
+    return true;
+}
+
+DeduplicateStats scene_deduplicate(Scene* scene) {
+    auto stats = DeduplicateStats();
+    auto slots = _DeduplicateSlots();
+    if(scene->prims) {
+        for(auto prim : scene->prims->prims) {
+            if(is<Surface>(prim)) _deduplicate_collect(cast<Surface>(prim)->shape, slots);
+            else if(is<TransformedSurface>(prim)) _deduplicate_collect(cast<TransformedSurface>(prim)->shape, slots);
+            _deduplicate_collect(prim->material, slots);
+        }
+    }
+    if(scene->lights) {
+        for(auto light : scene->lights->lights) {
+            if(is<AreaLight>(light)) _deduplicate_collect(cast<AreaLight>(light)->shape, slots);
+            else if(is<EnvLight>(light)) _deduplicate_collect(cast<EnvLight>(light)->envmap, slots);
+        }
+    }
+
+    // shapes are bucketed by the hash of their buffers, then compared in full
+    auto shape_merged = map<Shape*,Shape*>();
+    auto shape_buckets = map<unsigned long long,vector<Shape*>>();
+    for(auto slot : slots.shapes) {
+        auto shape = *slot;
+        if(shape_merged.count(shape)) continue;
+        shape_merged[shape] = shape;
+        auto buffers = _deduplicate_buffers(shape);
+        if(buffers.empty()) continue;
+        auto hash = _deduplicate_hash(14695981039346656037ull, &shape->_tid, sizeof(shape->_tid));
+        auto bytes = 0l;
+        for(auto buffer : buffers) {
+            hash = _deduplicate_hash(hash, &buffer.second, sizeof(buffer.second));
+            hash = _deduplicate_hash(hash, buffer.first, buffer.second);
+            bytes += buffer.second;
+        }
+        auto& bucket = shape_buckets[hash];
+        for(auto shared : bucket) {
+            if(not _deduplicate_same_settings(shape, shared) or not _deduplicate_same_buffers(buffers, _deduplicate_buffers(shared))) continue;
+            shape_merged[shape] = shared;
+            stats.shapes ++;
+            stats.bytes += bytes;
+            break;
+        }
+        if(shape_merged[shape] == shape) bucket.push_back(shape);
+    }
+
+    // textures are bucketed by file, then compared in full since the image may have been edited after loading
+    auto texture_merged = map<Texture*,Texture*>();
+    auto texture_buckets = map<pair<string,bool>,vector<Texture*>>();
+    for(auto slot : slots.textures) {
+        auto texture = *slot;
+        if(texture_merged.count(texture)) continue;
+        texture_merged[texture] = texture;
+        auto& bucket = texture_buckets[pair<string,bool>(texture->filename,texture->flipy)];
+        auto bytes = (long)texture->image.width()*texture->image.height()*sizeof(vec3f);
+        for(auto shared : bucket) {
+            if(texture->image.width() != shared->image.width() or texture->image.height() != shared->image.height()) continue;
+            if(bytes and memcmp(texture->image.begin(), shared->image.begin(), bytes)) continue;
+            texture_merged[texture] = shared;
+            stats.textures ++;
+            stats.bytes += bytes;
+            break;
+        }
+        if(texture_merged[texture] == texture) bucket.push_back(texture);
+    }
+
+    // duplicates are deleted only once no reference is left to them
+    for(auto slot : slots.shapes) *slot = shape_merged[*slot];
+    for(auto slot : slots.textures) *slot = texture_merged[*slot];
+    for(auto merged : shape_merged) if(merged.first != merged.second) delete merged.first;
+    for(auto merged : texture_merged) if(merged.first != merged.second) delete merged.first;
+    return stats;
+}
@@ -16,17 +16,20 @@ struct DrawOptions;
 struct RaytraceOptions;
 struct DistributionRaytraceOptions;
 struct PathtraceOptions;
+struct PhotonMap;
 
 struct Scene : Node {
     REGISTER_FAST_RTTI(Node,Scene,13)
     
 	Camera*              camera = nullptr;
+    CameraPath*         camera_path = nullptr; ///< views for batch rendering
 	LightGroup*          lights = nullptr;
 	PrimitiveGroup*      prims = nullptr;
     GizmoGroup*          gizmos = nullptr;
         
     GizmoGroup*         _defaultgizmos = nullptr;
     LightGroup*         _cameralights = nullptr;
+    PhotonMap*          _caustics = nullptr; ///< caustic photon map used by the raytracers (null if disabled)
 
     DrawOptions*        draw_opts = nullptr;
     RaytraceOptions*    raytrace_opts = nullptr;
@@ -68,6 +71,21 @@ inline void scene_cameralights_update(Scene* scene, const vector<vec3f>& dir, co
 }
 ///@}
 
+/// Duplicates merged by scene_deduplicate
+struct DeduplicateStats {
+    int     shapes = 0; ///< meshes merged into an identical one
+    int     textures = 0; ///< textures merged into one read from the same file
+    long    bytes = 0; ///< mesh buffer and image bytes freed
+};
+
+///@name de-duplication
+///@{
+/// merges meshes with identical buffers, and textures read from the same file with identical images, into
+/// shared instances, rewriting the references to them and deleting the duplicates;
+/// call after loading, before tesselating, accelerating or drawing the scene
+DeduplicateStats scene_deduplicate(Scene* scene);
+///@}
+
 ///@}
 
 #endif
@@ -4,6 +4,7 @@
 #include "raytrace.h"
 #include "distraytrace.h"
 #include "pathtrace.h"
+#include "mapped.h"
 
 ///@file igl/serialize.cpp Serialization. @ingroup igl
 
@@ -18,6 +19,7 @@ void Serializer::register_object_types() {
     register_object_type<TriangleMesh>();
     register_object_type<Mesh>();
     register_object_type<FaceMesh>();
+    register_object_type<MappedMesh>();
     register_object_type<CatmullClarkSubdiv>();
     register_object_type<Subdiv>();
     register_object_type<TesselationOverride>();
@@ -33,6 +35,7 @@ void Serializer::register_object_types() {
     register_object_type<LambertEmission>();
     register_object_type<Material>();
     register_object_type<Camera>();
+    register_object_type<CameraPath>();
     register_object_type<LightGroup>();
     register_object_type<PointLight>();
     register_object_type<DirectionalLight>();
@@ -65,6 +68,7 @@ const char* serialize_typename(Node* node) {
         else if(is<TriangleMesh>(node)) return "TriangleMesh";
         else if(is<Mesh>(node)) return "Mesh";
         else if(is<FaceMesh>(node)) return "FaceMesh";
+        else if(is<MappedMesh>(node)) return "MappedMesh";
         else if(is<CatmullClarkSubdiv>(node)) return "CatmullClarkSubdiv";
         else if(is<Subdiv>(node)) return "Subdiv";
         else if(is<TesselationOverride>(node)) return "TesselationOverride";
@@ -85,6 +89,7 @@ const char* serialize_typename(Node* node) {
         else return "Material";
     }
     else if(is<Camera>(node)) return "Camera";
+    else if(is<CameraPath>(node)) return "CameraPath";
     else if(is<LightGroup>(node)) return "LightGroup";
     else if(is<Light>(node)) {
         if(not node) return nullptr;
@@ -131,6 +136,9 @@ void serialize_members(Node* node, Serializer& ser) {
         auto shape = cast<Shape>(node);
         if(not shape) ERROR("node is null");
         ser.serialize_member("intersect_accelerator_use",shape->intersect_accelerator_use);
+        ser.serialize_member("intersect_accelerator_spatial_splits",shape->intersect_accelerator_spatial_splits);
+        ser.serialize_member("intersect_accelerator_linear",shape->intersect_accelerator_linear);
+        ser.serialize_member("intersect_accelerator_treelet_passes",shape->intersect_accelerator_treelet_passes);
         if(is<PointSet>(node)) {
             auto points = cast<PointSet>(node);
             ser.serialize_member("pos",points->pos);
@@ -172,6 +180,11 @@ void serialize_members(Node* node, Serializer& ser) {
             ser.serialize_member("triangle",mesh->triangle);
             ser.serialize_member("quad",mesh->quad);
         }
+        else if(is<MappedMesh>(node)) {
+            auto mesh = cast<MappedMesh>(node);
+            ser.serialize_member("filename",mesh->filename);
+            if(ser.is_reading()) mappedmesh_map(mesh);
+        }
         else if(is<CatmullClarkSubdiv>(node)) {
             auto subdiv = cast<CatmullClarkSubdiv>(node);
             ser.serialize_member("pos",subdiv->pos);
@@ -180,6 +193,7 @@ void serialize_members(Node* node, Serializer& ser) {
             ser.serialize_member("quad",subdiv->quad);
             ser.serialize_member("level",subdiv->level);
             ser.serialize_member("smooth",subdiv->smooth);
+            ser.serialize_member("limit",subdiv->limit);
         }
         else if(is<Subdiv>(node)) {
             auto subdiv = cast<Subdiv>(node);
@@ -291,6 +305,12 @@ void serialize_members(Node* node, Serializer& ser) {
         ser.serialize_member("orthographic",camera->orthographic);
         ser.serialize_member("shutter",camera->shutter);
     }
+    else if(is<CameraPath>(node)) {
+        auto path = cast<CameraPath>(node);
+        ser.serialize_member("cameras",path->cameras);
+        ser.serialize_member("views",path->views);
+        ser.serialize_member("turntable",path->turntable);
+    }
     else if(is<Light>(node)) {
         auto light = cast<Light>(node);
         ser.serialize_member("frame",light->frame);
@@ -352,7 +372,12 @@ void serialize_members(Node* node, Serializer& ser) {
         auto texture = cast<Texture>(node);
         ser.serialize_member("filename",texture->filename);
         ser.serialize_member("flipy",texture->flipy);
-        if(ser.is_reading()) texture->image = imageio_read_auto3f(texture->filename,texture->flipy);
+        if(ser.is_reading()) {
+            // repeated files are not decoded again, since the serializer replaces their textures with the first one
+            if(ser._textures.count(pair<string,bool>(texture->filename,texture->flipy))) return;
+            texture->image = imageio_read_auto3f(texture->filename,texture->flipy);
+            ERROR_IF_NOT(texture->image.width() > 0 and texture->image.height() > 0, "cannot load texture %s", texture->filename.c_str());
+        }
         else if(ser.is_writing_externals()) {
             if(texture->image.width() > 0 and texture->image.height() > 0) {
                 imageio_write_auto(texture->filename,texture->image,texture->flipy);
@@ -401,6 +426,7 @@ void serialize_members(Node* node, Serializer& ser) {
     else if(is<Scene>(node)) {
         auto scene = cast<Scene>(node);
         ser.serialize_member("camera",scene->camera);
+        ser.serialize_member("camera_path",scene->camera_path);
         ser.serialize_member("lights",scene->lights);
         ser.serialize_member("prims",scene->prims);
         ser.serialize_member("draw_opts",scene->draw_opts);
@@ -438,8 +464,13 @@ void serialize_members(Node* node, Serializer& ser) {
         ser.serialize_member("cameralights_dir", opts->cameralights_dir);
         ser.serialize_member("cameralights_col", opts->cameralights_col);
         ser.serialize_member("max_depth", opts->max_depth);
+        ser.serialize_member("crop", opts->crop);
         ser.serialize_member("shadows", opts->shadows);
         ser.serialize_member("reflections", opts->reflections);
+        ser.serialize_member("envlight_sh", opts->envlight_sh);
+        ser.serialize_member("caustics_photons", opts->caustics_photons);
+        ser.serialize_member("caustics_radius", opts->caustics_radius);
+        ser.serialize_member("caustics_nearest", opts->caustics_nearest);
     }
     else if(is<DistributionRaytraceOptions>(node)) {
         auto opts = cast<DistributionRaytraceOptions>(node);
@@ -453,10 +484,15 @@ void serialize_members(Node* node, Serializer& ser) {
         ser.serialize_member("cameralights_dir", opts->cameralights_dir);
         ser.serialize_member("cameralights_col", opts->cameralights_col);
         ser.serialize_member("max_depth", opts->max_depth);
+        ser.serialize_member("crop", opts->crop);
         ser.serialize_member("shadows", opts->shadows);
         ser.serialize_member("reflections", opts->reflections);
         ser.serialize_member("samples_ambient", opts->samples_ambient);
         ser.serialize_member("samples_reflect", opts->samples_reflect);
+        ser.serialize_member("envlight_sh", opts->envlight_sh);
+        ser.serialize_member("caustics_photons", opts->caustics_photons);
+        ser.serialize_member("caustics_radius", opts->caustics_radius);
+        ser.serialize_member("caustics_nearest", opts->caustics_nearest);
     }
     else if(is<PathtraceOptions>(node)) {
         auto opts = cast<PathtraceOptions>(node);
@@ -477,6 +513,9 @@ void serialize_members(Node* node, Serializer& ser) {
         ser.serialize_member("indirect_samples", opts->indirect_samples);
         ser.serialize_member("image_scale", opts->image_scale);
         ser.serialize_member("image_gamma", opts->image_gamma);
+        ser.serialize_member("guiding", opts->guiding);
+        ser.serialize_member("guiding_fraction", opts->guiding_fraction);
+        ser.serialize_member("crop", opts->crop);
     }
     else NOT_IMPLEMENTED_ERROR();
 }
@@ -29,6 +29,8 @@ void serialize_members(Node* node, Serializer& ser);
 struct Serializer {    
     StructuredStream*                   _ser = nullptr;
     bool                                _write_externals = true;
+    map<pair<string,bool>,Texture*>     _textures; ///< first texture read from each file (and flipy), shared by the others
+    DeduplicateStats                    _shared; ///< textures shared while reading
     
     Serializer(StructuredStream* ser, bool write_externals) :
         _ser(ser), _write_externals(write_externals) { register_object_types(); }
@@ -54,9 +56,10 @@ struct Serializer {
     }
     
     template<typename T>
-    static void read(T& value, StructuredStream* ser) {
+    static void read(T& value, StructuredStream* ser, DeduplicateStats* shared = nullptr) {
         auto s = Serializer(ser,false);
         s.serialize(value);
+        if(shared) *shared = s._shared;
     }
     
     template<typename T>
@@ -65,18 +68,19 @@ struct Serializer {
         s.serialize(value);
     }
     
+    /// reads value, sharing textures read from the same file (reported in shared if not null)
     template<typename T>
-    static void read_json(T& value, const string& filename) {
+    static void read_json(T& value, const string& filename, DeduplicateStats* shared = nullptr) {
         auto f = fopen(filename.c_str(), "rt");
         ERROR_IF_NOT(f, "cannot open file %s", filename.c_str());
-        read_json(value,f);
+        read_json(value,f,shared);
         fclose(f);
     }
     
     template<typename T>
-    static void read_json(T& value, FILE* f) {
+    static void read_json(T& value, FILE* f, DeduplicateStats* shared = nullptr) {
         auto ser = new JsonInputStream(f);
-        read(value,ser);
+        read(value,ser,shared);
         delete ser;
     }
     ///@}
@@ -115,6 +119,7 @@ struct Serializer {
     void serialize(range1i& value) { _serialize_rawdata(value); }
     void serialize(range1f& value) { _serialize_rawdata(value); }
     void serialize(range2f& value) { _serialize_rawdata(value); }
+    void serialize(range2i& value) { _serialize_rawdata(value); }
     void serialize(range3f& value) { _serialize_rawdata(value); }
     void serialize(vector<int>& value) { _serialize_vector_value(value); }
     void serialize(vector<float>& value) { _serialize_vector_value(value); }
@@ -220,6 +225,7 @@ struct Serializer {
                     _object_map.add(value,id);
                 }
                 serialize_members(value,*this);
+                if(is<Texture>(value)) _share_texture(value);
             }
             _ser->struct_end();
         } else {
@@ -241,6 +247,23 @@ struct Serializer {
         }
     }
     
+    // registers the first texture read from each file, and replaces later ones, which serialize_members did not
+    // load again, with it
+    template<typename T>
+    void _share_texture(T*& value) {
+        auto texture = dynamic_cast<Texture*>((Node*)value);
+        auto& first = _textures[pair<string,bool>(texture->filename,texture->flipy)];
+        if(not first) first = texture;
+        if(first == texture) return;
+        auto tag = _object_map.get_tag(texture);
+        _object_map.obj2tag.erase(texture);
+        delete texture;
+        value = dynamic_cast<T*>((Node*)first);
+        if(tag) _object_map.add(value,tag);
+        _shared.textures ++;
+        _shared.bytes += (long)first->image.width()*first->image.height()*sizeof(vec3f);
+    }
+    
     template<typename T>
     void _serialize_vector_object(vector<T*>& value) {
         if(_ser->is_reading()) value.resize(_ser->array_size());
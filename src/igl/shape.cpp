@@ -80,11 +80,15 @@ float spline_radius(Spline* spline, int elementid, float u) {
 }
 
 frame3f patch_frame(Patch* patch, int elementid, const vec2f& uv) {
+    return patch_frame(patch, elementid, bernstein_cubic(uv.x), bernstein_cubic(uv.y), bernstein_cubic_derivative(uv.x), bernstein_cubic_derivative(uv.y));
+}
+
+frame3f patch_frame(Patch* patch, int elementid, const vec4f& wu, const vec4f& wv, const vec4f& dwu, const vec4f& dwv) {
     auto p = patch->cubic[elementid];
     frame3f frame;
-    frame.o = interpolate_bezier_bicubic(patch->pos, p, uv);
-    frame.x = interpolate_bezier_bicubic_derivativex(patch->pos, p, uv);
-    frame.y = interpolate_bezier_bicubic_derivativey(patch->pos, p, uv);
+    frame.o = interpolate_bezier_bicubic(patch->pos, p, wu, wv);
+    frame.x = interpolate_bezier_bicubic(patch->pos, p, dwu, wv);
+    frame.y = interpolate_bezier_bicubic(patch->pos, p, wu, dwv);
     frame.z = normalize(cross(frame.x,frame.y));
     frame = orthonormalize(frame);
     return frame;
@@ -160,6 +164,19 @@ frame3f mesh_frame(Mesh* mesh, int elementid, const vec2f& uv) {
     return ff;
 }
 
+frame3f mappedmesh_frame(MappedMesh* mesh, int elementid, const vec2f& uv) {
+    auto f = mappedmesh_triangle_face(mesh,elementid);
+    frame3f ff;
+    ff.x = normalize(mesh->_pos[f.y]-mesh->_pos[f.x]);
+    ff.y = normalize(mesh->_pos[f.z]-mesh->_pos[f.x]);
+    if(mesh->_norm) ff.z = normalize(interpolate_baricentric_triangle(mesh->_norm[f.x],mesh->_norm[f.y],mesh->_norm[f.z],uv));
+    else if(elementid < mesh->_triangle_num) ff.z = triangle_normal(mesh->_pos[f.x], mesh->_pos[f.y], mesh->_pos[f.z]);
+    else { auto f = mesh->_quad[(elementid-mesh->_triangle_num)/2]; ff.z = quad_normal(mesh->_pos[f.x], mesh->_pos[f.y], mesh->_pos[f.z], mesh->_pos[f.w]); }
+    ff.o = interpolate_baricentric_triangle(mesh->_pos[f.x],mesh->_pos[f.y],mesh->_pos[f.z],uv);
+    ff = orthonormalize(ff);
+    return ff;
+}
+
 frame3f facemesh_frame(FaceMesh* mesh, int elementid, const vec2f& uv) {
     auto f = facemesh_triangle_face(mesh,elementid);
     frame3f ff;
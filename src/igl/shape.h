@@ -9,6 +9,7 @@
 ///@{
 
 struct BVHAccelerator;
+struct BVHNode;
 struct Texture;
 
 /// Abstract Shape
@@ -17,8 +18,12 @@ struct Shape : Node {
     
     BVHAccelerator*     _intersect_accelerator = nullptr; ///< intersection accelerator
     bool                intersect_accelerator_use = true; ///< whether to use the intersection accelerator
+    bool                intersect_accelerator_spatial_splits = false; ///< whether to build the accelerator with spatial splits
+    bool                intersect_accelerator_linear = false; ///< whether to build the accelerator from Morton codes (faster builds, for dynamic meshes)
+    int                 intersect_accelerator_treelet_passes = 0; ///< treelet restructuring passes after linear builds
 
     Shape*              _tesselation = nullptr; ///< shape tesselation
+    vector<Shape*>      _lods; ///< simplified levels of detail, from finer to coarser (see shape_lods_init)
 };
 
 /// Sphere aligned along Z axis
@@ -120,6 +125,7 @@ struct FaceMesh : Shape {
     vector<vec4i>       quad; ///< quad list with four vertex indices per quad
     
     vector<vec2i>       _tesselation_lines; ///< highkighted line segments (used for tesselation)
+    vector<vec3f>       _intersect_pos; ///< flattened positions, four per triangle or quad, used by intersection traversal (built with the accelerator)
 };
 
 /// Catmull-Clark subdivision surface on a pure quad mesh
@@ -134,6 +140,7 @@ struct CatmullClarkSubdiv : Shape {
     
     int                     level = 2; ///< tesselation level
     bool                    smooth = true; ///< tesselation smooth frames
+    bool                    limit = false; ///< tesselate by evaluating the limit surface (refining only around extraordinary vertices) instead of uniform refinement
     
     vector<vec2i>           _tesselation_lines; ///< highkighted line segments (used for tesselation)
 };
@@ -209,6 +216,33 @@ struct DisplacedShape : Shape {
     
     int                 level = 2; ///< tesselation level
     bool                smooth = true; ///< tesselation smooth frames
+    
+    float               _subdivide_time = 0; ///< time spent subdividing the base shape in the last tesselation
+    float               _displace_time = 0; ///< time spent displacing vertices in the last tesselation
+    float               _frames_time = 0; ///< time spent recomputing frames in the last tesselation
+};
+
+/// Mesh with triangles and quads whose data (and accelerator) is memory-mapped from a binary file and paged in on demand
+struct MappedMesh : Shape {
+    REGISTER_FAST_RTTI(Shape,MappedMesh,17)
+    
+    string              filename; ///< binary mesh filename (written by mappedmesh_write)
+    
+    int                 _pos_num = 0; ///< number of vertices
+    const vec3f*        _pos = nullptr; ///< mapped vertex position
+    const vec3f*        _norm = nullptr; ///< mapped vertex normal (can be null, then switch to face normals)
+    const vec2f*        _texcoord = nullptr; ///< mapped vertex texcoords (can be null)
+    int                 _triangle_num = 0; ///< number of triangles
+    const vec3i*        _triangle = nullptr; ///< mapped triangle list
+    int                 _quad_num = 0; ///< number of quads
+    const vec4i*        _quad = nullptr; ///< mapped quad list
+    int                 _nodes_num = 0; ///< number of mapped bvh nodes (zero if the file has no bvh)
+    const BVHNode*      _nodes = nullptr; ///< mapped bvh nodes in breadth-first order
+    int                 _sorted_prims_num = 0; ///< number of mapped bvh primitives
+    const int*          _sorted_prims = nullptr; ///< mapped bvh sorted primitives
+    
+    void*               _mapped_data = nullptr; ///< mapped file
+    size_t              _mapped_size = 0; ///< mapped file size
 };
 
 ///@name bezier spline.patch utilities
@@ -254,6 +288,7 @@ frame3f triangle_frame(Triangle* triangle, const vec2f& uv);
 frame3f spline_frame(Spline* spline, int elementid, float u);
 float spline_radius(Spline* spline, int elementid, float u);
 frame3f patch_frame(Patch* patch, int elementid, const vec2f& uv);
+frame3f patch_frame(Patch* patch, int elementid, const vec4f& wu, const vec4f& wv, const vec4f& dwu, const vec4f& dwv);
 
 frame3f pointset_frame(PointSet* pointset, int elementid, const vec2f& uv);
 frame3f lineset_cylinder_frame(LineSet* lines, int elementid);
@@ -261,6 +296,7 @@ frame3f lineset_frame(LineSet* lines, int elementid, const vec2f& uv);
 frame3f trianglemesh_frame(TriangleMesh* mesh, int elementid, const vec2f& uv);
 frame3f mesh_frame(Mesh* mesh, int elementid, const vec2f& uv);
 frame3f facemesh_frame(FaceMesh* mesh, int elementid, const vec2f& uv);
+frame3f mappedmesh_frame(MappedMesh* mesh, int elementid, const vec2f& uv);
 ///@}
 
 ///@name mesh utilities
@@ -273,6 +309,14 @@ inline vec3i mesh_triangle_face(Mesh* mesh, int elementid) {
         else return vec3i(f.x,f.z,f.w);
     }
 }
+inline vec3i mappedmesh_triangle_face(MappedMesh* mesh, int elementid) {
+    if(elementid < mesh->_triangle_num) return mesh->_triangle[elementid];
+    else {
+        auto f = mesh->_quad[(elementid - mesh->_triangle_num)/2];
+        if((elementid - mesh->_triangle_num) % 2 == 0) return vec3i(f.x,f.y,f.z);
+        else return vec3i(f.x,f.z,f.w);
+    }
+}
 inline vec3i facemesh_triangle_face(FaceMesh* mesh, int elementid) {
     if(elementid < mesh->triangle.size()) return mesh->triangle[elementid];
     else {
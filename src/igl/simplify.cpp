@@ -0,0 +1,384 @@
+#include "simplify.h"
+#include "intersect.h"
+
+#include <algorithm>
+
+///@file igl/simplify.cpp Mesh simplification and levels of detail. @ingroup igl
+
+// symmetric 4x4 error quadric, upper triangle of [a b c d]^T [a b c d] for planes ax+by+cz+d=0
+using _Quadric = array<double,10>;
+
+// weight of the constraint planes of crease edges, relative to the squared edge length
+const double _simplify_crease_weight = 100;
+// vertices with larger valence are not collapsed
+const int _simplify_max_valence = 64;
+
+_Quadric _quadric_plane(const vec3d& n, double d, double w) {
+    return {{ w*n.x*n.x, w*n.x*n.y, w*n.x*n.z, w*n.x*d, w*n.y*n.y, w*n.y*n.z, w*n.y*d, w*n.z*n.z, w*n.z*d, w*d*d }};
+}
+
+void _quadric_add(_Quadric& q, const _Quadric& a) { for(int i = 0; i < 10; i ++) q[i] += a[i]; }
+
+double _quadric_error(const _Quadric& q, const vec3d& p) {
+    return q[0]*p.x*p.x + 2*q[1]*p.x*p.y + 2*q[2]*p.x*p.z + 2*q[3]*p.x +
+           q[4]*p.y*p.y + 2*q[5]*p.y*p.z + 2*q[6]*p.y +
+           q[7]*p.z*p.z + 2*q[8]*p.z + q[9];
+}
+
+// position with the least error, false if the quadric is (nearly) singular, e.g. in flat regions
+bool _quadric_optimal(const _Quadric& q, vec3d& p) {
+    auto a = q[0], b = q[1], c = q[2], d = q[4], e = q[5], f = q[7];
+    auto det = a*(d*f-e*e) - b*(b*f-c*e) + c*(b*e-c*d);
+    auto trace = a + d + f;
+    if(not (fabs(det) > 1e-8*trace*trace*trace)) return false;
+    auto x = -q[3], y = -q[6], z = -q[8];
+    p = vec3d((d*f-e*e)*x + (c*e-b*f)*y + (b*e-c*d)*z,
+              (c*e-b*f)*x + (a*f-c*c)*y + (b*c-a*e)*z,
+              (b*e-c*d)*x + (b*c-a*e)*y + (a*d-b*b)*z) / det;
+    return true;
+}
+
+// candidate edge collapse, moving keep to pos and removing remove
+struct _SimplifyCollapse {
+    bool        valid = false;
+    int         keep = -1, remove = -1;
+    vec3f       pos = zero3f;
+    float       t = 0; ///< position along the edge from keep to remove, to interpolate attributes
+    double      cost = 0;
+};
+
+// vertex to face adjacency in compressed rows
+struct _SimplifyAdjacency {
+    vector<int>     start; ///< faces of vertex i are face[start[i]..start[i+1])
+    vector<int>     face;
+};
+
+_SimplifyAdjacency _simplify_adjacency(const vector<vec3i>& triangle, int nv) {
+    auto adjacency = _SimplifyAdjacency();
+    adjacency.start.assign(nv+1, 0);
+    adjacency.face.resize(triangle.size()*3);
+    for(auto t : triangle) for(int k = 0; k < 3; k ++) adjacency.start[t[k]+1] ++;
+    for(int i = 0; i < nv; i ++) adjacency.start[i+1] += adjacency.start[i];
+    auto next = vector<int>(adjacency.start.begin(), adjacency.start.end()-1);
+    for(int f = 0; f < triangle.size(); f ++) for(int k = 0; k < 3; k ++) adjacency.face[next[triangle[f][k]]++] = f;
+    return adjacency;
+}
+
+// vertices sharing a face with v (but v), false if there are too many
+bool _simplify_ring(const vector<vec3i>& triangle, const _SimplifyAdjacency& adjacency, int v, int* ring, int& n) {
+    n = 0;
+    for(int i = adjacency.start[v]; i < adjacency.start[v+1]; i ++) {
+        for(int k = 0; k < 3; k ++) {
+            auto w = triangle[adjacency.face[i]][k];
+            if(w == v or std::find(ring, ring+n, w) != ring+n) continue;
+            if(n == _simplify_max_valence) return false;
+            ring[n++] = w;
+        }
+    }
+    return true;
+}
+
+_SimplifyCollapse _simplify_collapse(TriangleMesh* mesh, const vector<_Quadric>& quadric, const vector<char>& locked,
+                                     const _SimplifyAdjacency& adjacency, int a, int b) {
+    auto collapse = _SimplifyCollapse();
+    if(locked[a] and locked[b]) return collapse;
+    auto keep = (locked[b]) ? b : a, remove = (locked[b]) ? a : b;
+
+    // the edge should be shared by two faces whose other vertices are the only common neighbors, so that
+    // collapsing it does not create non-manifold edges
+    int ring_keep[_simplify_max_valence], ring_remove[_simplify_max_valence], nkeep, nremove;
+    if(not _simplify_ring(mesh->triangle, adjacency, keep, ring_keep, nkeep)) return collapse;
+    if(not _simplify_ring(mesh->triangle, adjacency, remove, ring_remove, nremove)) return collapse;
+    auto common = 0;
+    for(int i = 0; i < nkeep; i ++) if(std::find(ring_remove, ring_remove+nremove, ring_keep[i]) != ring_remove+nremove) common ++;
+    if(common != 2) return collapse;
+    auto shared = 0;
+    for(int i = adjacency.start[keep]; i < adjacency.start[keep+1]; i ++) {
+        auto t = mesh->triangle[adjacency.face[i]];
+        if(t.x == remove or t.y == remove or t.z == remove) shared ++;
+    }
+    if(shared != 2) return collapse;
+
+    // the optimal position if well defined and close to the edge, otherwise the best of endpoints and midpoint
+    auto q = quadric[keep];
+    _quadric_add(q, quadric[remove]);
+    auto pk = vec3d(mesh->pos[keep]), pr = vec3d(mesh->pos[remove]);
+    auto p = pk;
+    if(not locked[keep]) {
+        auto optimal = zero3d;
+        if(_quadric_optimal(q, optimal) and length(optimal-(pk+pr)/2) <= length(pr-pk)) p = optimal;
+        else {
+            for(auto candidate : { pr, (pk+pr)/2 }) {
+                if(_quadric_error(q, candidate) < _quadric_error(q, p)) p = candidate;
+            }
+        }
+    }
+
+    // faces that are kept should not flip
+    for(auto v : { keep, remove }) {
+        for(int i = adjacency.start[v]; i < adjacency.start[v+1]; i ++) {
+            auto t = mesh->triangle[adjacency.face[i]];
+            auto has_keep = t.x == keep or t.y == keep or t.z == keep;
+            auto has_remove = t.x == remove or t.y == remove or t.z == remove;
+            if(has_keep and has_remove) continue;
+            vec3d old_pos[3], new_pos[3];
+            for(int k = 0; k < 3; k ++) {
+                old_pos[k] = vec3d(mesh->pos[t[k]]);
+                new_pos[k] = (t[k] == keep or t[k] == remove) ? p : old_pos[k];
+            }
+            auto old_norm = cross(old_pos[1]-old_pos[0], old_pos[2]-old_pos[0]);
+            auto new_norm = cross(new_pos[1]-new_pos[0], new_pos[2]-new_pos[0]);
+            if(length(old_norm) == 0) continue;
+            if(length(new_norm) == 0 or dot(normalize(old_norm), normalize(new_norm)) < 0.25) return collapse;
+        }
+    }
+
+    auto e = pr - pk;
+    collapse.valid = true;
+    collapse.keep = keep;
+    collapse.remove = remove;
+    collapse.pos = vec3f(p);
+    collapse.t = (dot(e,e) > 0) ? clamp((float)(dot(p-pk,e)/dot(e,e)), 0.0f, 1.0f) : 0;
+    collapse.cost = std::max(0.0, _quadric_error(q, p));
+    return collapse;
+}
+
+// plane quadrics of the faces, weighted by area, and locks for vertices on borders, seams and non-manifold edges;
+// creases get planes through the edge, orthogonal to its faces, so that they stay sharp
+void _simplify_init(TriangleMesh* mesh, float crease_angle, vector<_Quadric>& quadric, vector<char>& locked) {
+    auto nv = (int)mesh->pos.size();
+    quadric.assign(nv, _Quadric());
+    locked.assign(nv, false);
+    auto face_norm = vector<vec3d>(mesh->triangle.size());
+    for(int f = 0; f < mesh->triangle.size(); f ++) {
+        auto t = mesh->triangle[f];
+        auto p0 = vec3d(mesh->pos[t.x]), p1 = vec3d(mesh->pos[t.y]), p2 = vec3d(mesh->pos[t.z]);
+        auto n = cross(p1-p0, p2-p0);
+        auto l = length(n);
+        if(l == 0) continue;
+        face_norm[f] = n / l;
+        auto plane = _quadric_plane(face_norm[f], -dot(face_norm[f],p0), l/2);
+        for(int k = 0; k < 3; k ++) _quadric_add(quadric[t[k]], plane);
+    }
+
+    auto edges = vector<pair<long long,int>>();
+    edges.reserve(mesh->triangle.size()*3);
+    for(int f = 0; f < mesh->triangle.size(); f ++) {
+        for(int k = 0; k < 3; k ++) {
+            auto a = mesh->triangle[f][k], b = mesh->triangle[f][(k+1)%3];
+            edges.push_back(pair<long long,int>((long long)std::min(a,b)*nv + std::max(a,b), f));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    auto cos_crease = cos((double)crease_angle);
+    for(int i = 0, j = 0; i < edges.size(); i = j) {
+        for(j = i+1; j < edges.size() and edges[j].first == edges[i].first; j ++);
+        auto a = (int)(edges[i].first / nv), b = (int)(edges[i].first % nv);
+        if(j-i != 2) { locked[a] = locked[b] = true; continue; }
+        auto n0 = face_norm[edges[i].second], n1 = face_norm[edges[i+1].second];
+        if(dot(n0,n1) >= cos_crease) continue;
+        auto pa = vec3d(mesh->pos[a]), e = vec3d(mesh->pos[b]) - pa;
+        for(auto n : { n0, n1 }) {
+            auto m = cross(e, n);
+            if(length(m) == 0) continue;
+            m = normalize(m);
+            auto plane = _quadric_plane(m, -dot(m,pa), _simplify_crease_weight*dot(e,e));
+            _quadric_add(quadric[a], plane);
+            _quadric_add(quadric[b], plane);
+        }
+    }
+}
+
+// applies one parallel pass of independent collapses, removing at most max_faces faces; returns the collapses applied
+int _simplify_pass(TriangleMesh* mesh, vector<_Quadric>& quadric, const vector<char>& locked, int max_faces) {
+    auto nv = (int)mesh->pos.size();
+    auto adjacency = _simplify_adjacency(mesh->triangle, nv);
+    auto keys = vector<long long>();
+    keys.reserve(mesh->triangle.size()*3);
+    for(auto t : mesh->triangle) {
+        for(int k = 0; k < 3; k ++) keys.push_back((long long)std::min(t[k],t[(k+1)%3])*nv + std::max(t[k],t[(k+1)%3]));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    auto collapses = vector<_SimplifyCollapse>(keys.size());
+    parallel_for(keys.size(), [&](int start, int end) {
+        for(int i = start; i < end; i ++) {
+            collapses[i] = _simplify_collapse(mesh, quadric, locked, adjacency, (int)(keys[i]/nv), (int)(keys[i]%nv));
+        }
+    });
+
+    // a collapse is applied if it is the cheapest valid one within the edges of the neighbors of its endpoints,
+    // so that applied collapses touch disjoint faces
+    auto better = [&](int i, int j) {
+        return j < 0 or collapses[i].cost < collapses[j].cost or (collapses[i].cost == collapses[j].cost and i < j);
+    };
+    auto best = vector<int>(nv, -1);
+    for(int i = 0; i < keys.size(); i ++) {
+        if(not collapses[i].valid) continue;
+        for(auto v : { collapses[i].keep, collapses[i].remove }) if(better(i, best[v])) best[v] = i;
+    }
+    auto best_ring = best;
+    for(auto key : keys) {
+        auto a = (int)(key/nv), b = (int)(key%nv);
+        if(best[b] >= 0 and better(best[b], best_ring[a])) best_ring[a] = best[b];
+        if(best[a] >= 0 and better(best[a], best_ring[b])) best_ring[b] = best[a];
+    }
+    auto selected = vector<int>();
+    for(int i = 0; i < keys.size(); i ++) {
+        if(collapses[i].valid and best_ring[collapses[i].keep] == i and best_ring[collapses[i].remove] == i) selected.push_back(i);
+    }
+    std::sort(selected.begin(), selected.end(), [&](int i, int j) { return better(i, j); });
+    if(selected.size() > (max_faces+1)/2) selected.resize((max_faces+1)/2);
+
+    auto remap = vector<int>(nv);
+    for(int v = 0; v < nv; v ++) remap[v] = v;
+    parallel_for(selected.size(), [&](int start, int end) {
+        for(int i = start; i < end; i ++) {
+            auto& collapse = collapses[selected[i]];
+            auto keep = collapse.keep, remove = collapse.remove;
+            auto t = collapse.t;
+            remap[remove] = keep;
+            mesh->pos[keep] = collapse.pos;
+            _quadric_add(quadric[keep], quadric[remove]);
+            if(not mesh->norm.empty()) mesh->norm[keep] = normalize(mesh->norm[keep]*(1-t) + mesh->norm[remove]*t);
+            if(not mesh->texcoord.empty()) mesh->texcoord[keep] = mesh->texcoord[keep]*(1-t) + mesh->texcoord[remove]*t;
+        }
+    });
+
+    auto triangle = vector<vec3i>();
+    triangle.reserve(mesh->triangle.size());
+    for(auto t : mesh->triangle) {
+        t = vec3i(remap[t.x], remap[t.y], remap[t.z]);
+        if(t.x != t.y and t.y != t.z and t.z != t.x) triangle.push_back(t);
+    }
+    mesh->triangle = triangle;
+    return selected.size();
+}
+
+TriangleMesh* simplify_mesh(Shape* shape, int target, float crease_angle) {
+    if(shape->_tesselation) return simplify_mesh(shape->_tesselation, target, crease_angle);
+    auto mesh = new TriangleMesh();
+    if(is<TriangleMesh>(shape)) {
+        auto source = cast<TriangleMesh>(shape);
+        mesh->pos = source->pos;
+        mesh->norm = source->norm;
+        mesh->texcoord = source->texcoord;
+        mesh->triangle = source->triangle;
+    }
+    else if(is<Mesh>(shape)) {
+        auto source = cast<Mesh>(shape);
+        mesh->pos = source->pos;
+        mesh->norm = source->norm;
+        mesh->texcoord = source->texcoord;
+        mesh->triangle = source->triangle;
+        for(auto q : source->quad) {
+            mesh->triangle.push_back(vec3i(q.x,q.y,q.z));
+            mesh->triangle.push_back(vec3i(q.x,q.z,q.w));
+        }
+    }
+    else NOT_IMPLEMENTED_ERROR();
+    mesh->intersect_accelerator_use = shape->intersect_accelerator_use;
+    mesh->intersect_accelerator_spatial_splits = shape->intersect_accelerator_spatial_splits;
+    mesh->intersect_accelerator_linear = shape->intersect_accelerator_linear;
+    mesh->intersect_accelerator_treelet_passes = shape->intersect_accelerator_treelet_passes;
+
+    auto quadric = vector<_Quadric>();
+    auto locked = vector<char>();
+    _simplify_init(mesh, crease_angle, quadric, locked);
+    while(mesh->triangle.size() > target) {
+        if(not _simplify_pass(mesh, quadric, locked, mesh->triangle.size() - target)) break;
+    }
+
+    // drop the vertices left unused
+    auto index = vector<int>(mesh->pos.size(), -1);
+    auto nv = 0;
+    for(auto& t : mesh->triangle) {
+        for(int k = 0; k < 3; k ++) {
+            if(index[t[k]] < 0) {
+                index[t[k]] = nv;
+                mesh->pos[nv] = mesh->pos[t[k]];
+                if(not mesh->norm.empty()) mesh->norm[nv] = mesh->norm[t[k]];
+                if(not mesh->texcoord.empty()) mesh->texcoord[nv] = mesh->texcoord[t[k]];
+                nv ++;
+            }
+            t[k] = index[t[k]];
+        }
+    }
+    mesh->pos.resize(nv);
+    if(not mesh->norm.empty()) mesh->norm.resize(nv);
+    if(not mesh->texcoord.empty()) mesh->texcoord.resize(nv);
+    return mesh;
+}
+
+int lod_triangles(Shape* shape) {
+    if(shape->_tesselation) return lod_triangles(shape->_tesselation);
+    if(is<TriangleMesh>(shape)) return cast<TriangleMesh>(shape)->triangle.size();
+    if(is<Mesh>(shape)) return cast<Mesh>(shape)->triangle.size() + 2*cast<Mesh>(shape)->quad.size();
+    return 0;
+}
+
+void shape_lods_init(Shape* shape, const LodOptions& opts) {
+    for(auto lod : shape->_lods) delete lod;
+    shape->_lods.clear();
+    auto level = shape;
+    auto triangles = lod_triangles(shape);
+    while(shape->_lods.size() < opts.levels and triangles*opts.ratio >= opts.min_triangles) {
+        auto lod = simplify_mesh(level, triangles*opts.ratio, opts.crease_angle);
+        // stop once borders and creases keep the mesh from shrinking much
+        if(lod_triangles(lod) > triangles*(1+opts.ratio)/2) { delete lod; break; }
+        shape->_lods.push_back(lod);
+        level = lod;
+        triangles = lod_triangles(lod);
+    }
+}
+
+void scene_lods_init(Scene* scene, const LodOptions& opts) {
+    // shapes shared by several primitives are simplified once; each runs its passes in parallel
+    auto initialized = map<Shape*,bool>();
+    for(auto prim : scene->prims->prims) {
+        auto shape = (is<Surface>(prim)) ? cast<Surface>(prim)->shape : (is<TransformedSurface>(prim)) ? cast<TransformedSurface>(prim)->shape : nullptr;
+        if(not shape or initialized[shape]) continue;
+        initialized[shape] = true;
+        if(lod_triangles(shape)) shape_lods_init(shape, opts);
+    }
+}
+
+bool scene_lods_select(Scene* scene, Camera* camera, int res, const LodOptions& opts) {
+    auto changed = false;
+    for(auto prim : scene->prims->prims) {
+        auto shape = (Shape*)nullptr;
+        auto bbox = range3f();
+        if(is<Surface>(prim)) {
+            shape = cast<Surface>(prim)->shape;
+            bbox = intersect_shape_bounds(shape);
+        }
+        else if(is<TransformedSurface>(prim)) {
+            auto transformed = cast<TransformedSurface>(prim);
+            shape = transformed->shape;
+            bbox = transform_bbox(transformed_matrix(transformed, 0), intersect_shape_bounds(shape));
+        }
+        else NOT_IMPLEMENTED_ERROR();
+
+        // coarsest level with at least a triangle every pixels_per_triangle pixels of the projected bounding sphere
+        auto lod = (Shape*)nullptr;
+        if(not shape->_lods.empty() and isvalid(bbox)) {
+            bbox = transform_bbox(prim->frame, bbox);
+            auto radius = length(size(bbox)) / 2;
+            auto distance = length(center(bbox) - camera->frame.o);
+            if(distance > radius) {
+                auto radius_pixels = radius / camera->image_height * res;
+                if(not camera->orthographic) radius_pixels *= camera->image_dist / distance;
+                auto triangles = pif * radius_pixels * radius_pixels / opts.pixels_per_triangle;
+                for(auto level : shape->_lods) {
+                    if(lod_triangles(level) < triangles) break;
+                    lod = level;
+                }
+            }
+        }
+        auto& selected = (is<Surface>(prim)) ? cast<Surface>(prim)->_lod : cast<TransformedSurface>(prim)->_lod;
+        changed = changed or selected != lod;
+        selected = lod;
+    }
+    return changed;
+}
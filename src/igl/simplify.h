@@ -0,0 +1,44 @@
+#ifndef _SIMPLIFY_H_
+#define _SIMPLIFY_H_
+
+#include "scene.h"
+
+///@file igl/simplify.h Mesh simplification and levels of detail. @ingroup igl
+///@defgroup simplify Mesh simplification and levels of detail
+///@ingroup igl
+///@{
+
+/// Level of detail settings
+struct LodOptions {
+    int         levels = 6; ///< max levels built for each shape
+    float       ratio = 0.25f; ///< triangles of each level relative to the previous one
+    int         min_triangles = 256; ///< shapes, or levels, with fewer triangles are not simplified further
+    float       crease_angle = pif / 3; ///< edges whose faces meet at a larger angle are kept as creases
+    float       pixels_per_triangle = 1; ///< projected area per triangle used to select levels
+};
+
+///@name simplification interface
+///@{
+/// simplifies a TriangleMesh or Mesh (quads are split) to about target triangles by quadric error edge
+/// collapses (Garland and Heckbert 1997); borders, and so UV and normal seams, are kept in place, and creases
+/// are kept sharp by constraint planes; collapses are applied in parallel passes of independent edges
+TriangleMesh* simplify_mesh(Shape* shape, int target, float crease_angle = pif / 3);
+///@}
+
+///@name level of detail interface
+///@{
+/// number of triangles of a TriangleMesh or Mesh (quads count as two), 0 for other shapes
+int lod_triangles(Shape* shape);
+/// builds shape->_lods, each simplified from the previous level (or the shape tesselation)
+void shape_lods_init(Shape* shape, const LodOptions& opts);
+/// builds the levels of detail of all surface shapes in the scene
+void scene_lods_init(Scene* scene, const LodOptions& opts);
+/// selects for each surface the coarsest level with enough triangles for the projected area of its bounds in
+/// camera, for images res pixels high (the shape itself if closer than its bounds or with no levels); returns
+/// whether any selection changed, since intersection then needs intersect_scene_reaccelerate
+bool scene_lods_select(Scene* scene, Camera* camera, int res, const LodOptions& opts);
+///@}
+
+///@}
+
+#endif
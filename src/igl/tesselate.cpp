@@ -2,40 +2,43 @@
 
 ///@file igl/tesselate.cpp Tesselation. @ingroup igl
 
-Shape* _tesselate_shape_uniform(const function<frame3f (const vec2f&)> shape_frame,
-                                const function<vec2f (const vec2f&)> shape_texcoord,
-                                int ur, int vr, bool ccw, bool smooth) {
+// grid vertex (i,j) is evaluated at uv = (i/ur,j/vr); the frame and texcoord functors take the grid indices so that
+// callers can reuse values shared along rows or columns; rows are evaluated in parallel into preallocated arrays,
+// so the result does not depend on the number of threads
+template<typename FrameFunc, typename TexcoordFunc>
+Mesh* _tesselate_shape_uniform(const FrameFunc& shape_frame, const TexcoordFunc& shape_texcoord,
+                               int ur, int vr, bool ccw, bool smooth) {
     auto tesselation = new Mesh();
-    auto line = vector<vec2i>();
-    
-    for(int i = 0; i <= ur; i ++) {
-        for(int j = 0; j <= vr; j ++) {
-            float u = i / float(ur);
-            float v = j / float(vr);
-            vec2f uv = vec2f(u,v);
-            auto f = shape_frame(uv);
-            tesselation->pos.push_back(f.o);
-            if(smooth) tesselation->norm.push_back(f.z);
-            tesselation->texcoord.push_back(shape_texcoord(uv));
+    tesselation->pos.resize((ur+1)*(vr+1));
+    if(smooth) tesselation->norm.resize((ur+1)*(vr+1));
+    tesselation->texcoord.resize((ur+1)*(vr+1));
+    tesselation->quad.resize(ur*vr);
+    
+    parallel_for(ur+1, [&](int start, int end){
+        for(int i = start; i < end; i ++) {
+            for(int j = 0; j <= vr; j ++) {
+                auto vid = i*(vr+1)+j;
+                auto f = shape_frame(i,j);
+                tesselation->pos[vid] = f.o;
+                if(smooth) tesselation->norm[vid] = f.z;
+                tesselation->texcoord[vid] = shape_texcoord(i,j);
+            }
+            if(i == ur) continue;
+            for(int j = 0; j < vr; j ++) {
+                vec4i f = vec4i((i+0)*(vr+1)+(j+0),(i+0)*(vr+1)+(j+1),(i+1)*(vr+1)+(j+1),(i+1)*(vr+1)+(j+0));
+                if(not ccw) { swap(f.y,f.w); }
+                tesselation->quad[i*vr+j] = f;
+            }
         }
-    }
-    
-    for(int i = 0; i < ur; i ++) {
-        for(int j = 0; j < vr; j ++) {
-            vec4i f = vec4i((i+0)*(vr+1)+(j+0),(i+0)*(vr+1)+(j+1),(i+1)*(vr+1)+(j+1),(i+1)*(vr+1)+(j+0));
-            if(not ccw) { swap(f.y,f.w); }
-            tesselation->quad.push_back(f);
-        }
-    }
+    });
     
     return tesselation;
 }
 
-Shape* _tesselate_shape_uniform(const function<frame3f (const vec2f&)> shape_frame,
-                                const function<vec2f (const vec2f&)> shape_texcoord,
-                                int ur, int vr, int ul, int vl, bool ccw, bool smooth) {
-    auto tesselation = cast<Mesh>(_tesselate_shape_uniform(shape_frame, shape_texcoord, ur, vr, ccw, smooth));
-    auto line = vector<vec2i>();
+template<typename FrameFunc, typename TexcoordFunc>
+Mesh* _tesselate_shape_uniform(const FrameFunc& shape_frame, const TexcoordFunc& shape_texcoord,
+                               int ur, int vr, int ul, int vl, bool ccw, bool smooth) {
+    auto tesselation = _tesselate_shape_uniform(shape_frame, shape_texcoord, ur, vr, ccw, smooth);
     
     for(int li = 0; li <= ul; li ++) {
         int i = li * ur / ul;
@@ -55,27 +58,26 @@ Shape* _tesselate_shape_uniform(const function<frame3f (const vec2f&)> shape_fra
     return tesselation;
 }
 
-Shape* _tesselate_shape_uniform(const function<frame3f (float)> shape_frame,
-                                const function<float (float)> shape_radius,
-                                const function<vec2f (float)> shape_texcoord,
-                                int ur, bool smooth) {
+template<typename FrameFunc, typename RadiusFunc, typename TexcoordFunc>
+LineSet* _tesselate_shape_uniform(const FrameFunc& shape_frame, const RadiusFunc& shape_radius, const TexcoordFunc& shape_texcoord,
+                                  int ur, bool smooth) {
     auto tesselation = new LineSet();
-    auto line = vector<vec2i>();
-    
-    for(int i = 0; i <= ur; i ++) {
-        float u = i / float(ur);
-        auto f = shape_frame(u);
-        tesselation->pos.push_back(f.o);
-        tesselation->radius.push_back(shape_radius(u));
-        tesselation->texcoord.push_back(shape_texcoord(u));
-        // if(smooth) tesselation->norm.push_back(f.z);
-        tesselation->texcoord.push_back({u,0});
-    }
+    tesselation->pos.resize(ur+1);
+    tesselation->radius.resize(ur+1);
+    tesselation->texcoord.resize(ur+1);
+    tesselation->line.resize(ur);
     
-    for(int i = 0; i < ur; i ++) {
-        vec2i l = vec2i(i+0,i+1);
-        tesselation->line.push_back(l);
-    }
+    parallel_for(ur+1, [&](int start, int end){
+        for(int i = start; i < end; i ++) {
+            float u = i / float(ur);
+            auto f = shape_frame(u);
+            tesselation->pos[i] = f.o;
+            tesselation->radius[i] = shape_radius(u);
+            tesselation->texcoord[i] = shape_texcoord(u);
+            // if(smooth) tesselation->norm[i] = f.z;
+            if(i < ur) tesselation->line[i] = vec2i(i+0,i+1);
+        }
+    });
     
     return tesselation;
 }
@@ -367,6 +369,279 @@ CatmullClarkSubdiv* _tesselate_catmullclark_once(CatmullClarkSubdiv* subdiv) {
     return tesselation;
 }
 
+// Catmull-Clark limit surface: faces whose vertices are all interior with valence 4 are bicubic B-spline patches
+// and are evaluated exactly; the other faces are refined locally, together with their one-ring only, until their
+// children become regular or the target level is reached, where corners are moved to their limit positions
+
+// directed edge to face adjacency of a consistently oriented quad mesh
+struct _CatmullClarkAdjacency {
+    map<pair<int,int>,int>  edge_face; // face containing each directed edge
+    vector<vector<int>>     vertex_faces; // faces incident to each vertex
+    
+    _CatmullClarkAdjacency(CatmullClarkSubdiv* subdiv) : vertex_faces(subdiv->pos.size()) {
+        for(int fid = 0; fid < subdiv->quad.size(); fid ++) {
+            auto f = subdiv->quad[fid];
+            for(int k = 0; k < 4; k ++) {
+                edge_face[pair<int,int>(f[k],f[(k+1)%4])] = fid;
+                vertex_faces[f[k]].push_back(fid);
+            }
+        }
+    }
+    
+    // face containing the directed edge (a,b) (-1 if none)
+    int face(int a, int b) const {
+        auto it = edge_face.find(pair<int,int>(a,b));
+        return (it != edge_face.end()) ? it->second : -1;
+    }
+};
+
+// quad rotated so that it starts at vertex v
+inline vec4i _quad_rotate(const vec4i& f, int v) {
+    for(int k = 0; k < 4; k ++) if(f[k] == v) return vec4i(f[k],f[(k+1)%4],f[(k+2)%4],f[(k+3)%4]);
+    return f;
+}
+
+// face containing the directed edge (a,b), rotated to start at a
+bool _catmullclark_face(CatmullClarkSubdiv* subdiv, const _CatmullClarkAdjacency& adj, int a, int b, vec4i& f) {
+    auto fid = adj.face(a,b);
+    if(fid < 0) return false;
+    f = _quad_rotate(subdiv->quad[fid],a);
+    return true;
+}
+
+// edge neighbors e[i] and face diagonals d[i] of an interior vertex in order around it, so that each incident face is (v,e[i],d[i],e[i+1]);
+// false for boundary vertices
+bool _catmullclark_vertex_ring(CatmullClarkSubdiv* subdiv, const _CatmullClarkAdjacency& adj, int v, vector<int>& e, vector<int>& d) {
+    e.clear(); d.clear();
+    if(adj.vertex_faces[v].empty()) return false;
+    auto g = _quad_rotate(subdiv->quad[adj.vertex_faces[v][0]],v);
+    for(int i = 0; i < adj.vertex_faces[v].size(); i ++) {
+        e.push_back(g.y); d.push_back(g.z);
+        if(not _catmullclark_face(subdiv, adj, v, g.w, g)) return false;
+    }
+    return g.y == e[0];
+}
+
+// 4x4 control points of a regular face f, rows along f.x->f.w and columns along f.x->f.y; false if the face is not regular
+bool _catmullclark_regular_patch(CatmullClarkSubdiv* subdiv, const _CatmullClarkAdjacency& adj, const vec4i& f, int cp[4][4]) {
+    for(auto v : f) if(adj.vertex_faces[v].size() != 4) return false;
+    // edge neighbors (n0 = [f.y,f.x,..], ...) and corner neighbors (c0 = [n0.z,f.x,..], ...) 
+    vec4i n0, n1, n2, n3, c0, c1, c2, c3;
+    if(not _catmullclark_face(subdiv, adj, f.y, f.x, n0) or not _catmullclark_face(subdiv, adj, f.z, f.y, n1) or
+       not _catmullclark_face(subdiv, adj, f.w, f.z, n2) or not _catmullclark_face(subdiv, adj, f.x, f.w, n3)) return false;
+    if(not _catmullclark_face(subdiv, adj, n0.z, f.x, c0) or not _catmullclark_face(subdiv, adj, n1.z, f.y, c1) or
+       not _catmullclark_face(subdiv, adj, n2.z, f.z, c2) or not _catmullclark_face(subdiv, adj, n3.z, f.w, c3)) return false;
+    if(c0.z != n3.w or c1.z != n0.w or c2.z != n1.w or c3.z != n2.w) return false;
+    int rows[4][4] = { { c0.w, n0.z, n0.w, c1.w }, { n3.w, f.x, f.y, n1.z }, { n3.z, f.w, f.z, n1.w }, { c3.w, n2.w, n2.z, c2.w } };
+    for(int r = 0; r < 4; r ++) for(int c = 0; c < 4; c ++) cp[r][c] = rows[r][c];
+    return true;
+}
+
+// one-ring submesh of quad f, stored as its first face with the same vertex order
+CatmullClarkSubdiv* _catmullclark_local(CatmullClarkSubdiv* subdiv, const _CatmullClarkAdjacency& adj, const vec4i& f) {
+    auto local = new CatmullClarkSubdiv();
+    auto vmap = map<int,int>();
+    auto local_vertex = [&](int v) {
+        if(vmap.find(v) != vmap.end()) return vmap[v];
+        vmap[v] = local->pos.size();
+        local->pos.push_back(subdiv->pos[v]);
+        if(not subdiv->texcoord.empty()) local->texcoord.push_back(subdiv->texcoord[v]);
+        return vmap[v];
+    };
+    auto faces = vector<int>();
+    for(auto v : f) faces.insert(faces.end(), adj.vertex_faces[v].begin(), adj.vertex_faces[v].end());
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+    auto fid = adj.face(f.x,f.y);
+    local->quad.push_back(vec4i(local_vertex(f.x),local_vertex(f.y),local_vertex(f.z),local_vertex(f.w)));
+    for(auto gid : faces) {
+        if(gid == fid) continue;
+        auto g = subdiv->quad[gid];
+        local->quad.push_back(vec4i(local_vertex(g.x),local_vertex(g.y),local_vertex(g.z),local_vertex(g.w)));
+    }
+    return local;
+}
+
+// limit samples on the (n+1)x(n+1) grid of one control face
+struct _CatmullClarkGrid {
+    int             n = 0; ///< grid resolution
+    vector<vec3f>   pos; ///< positions
+    vector<vec3f>   norm; ///< normals (empty if not smooth)
+    vector<vec2f>   texcoord; ///< texcoords (empty if the subdiv has none)
+};
+
+// evaluates face f, covering the n x n block at (i0,j0) of grid, with u along f.x->f.y and v along f.x->f.w
+void _catmullclark_limit_face(CatmullClarkSubdiv* subdiv, const _CatmullClarkAdjacency& adj, const vec4i& f,
+                              int n, int i0, int j0, _CatmullClarkGrid& grid) {
+    auto smooth = not grid.norm.empty();
+    auto has_texcoord = not grid.texcoord.empty();
+    
+    // regular face: bicubic B-spline patch
+    int cp[4][4];
+    if(_catmullclark_regular_patch(subdiv, adj, f, cp)) {
+        auto w = vector<vec4f>(n+1), dw = vector<vec4f>(n+1);
+        for(int i = 0; i <= n; i ++) { w[i] = bspline_cubic(i / float(n)); dw[i] = bspline_cubic_derivative(i / float(n)); }
+        for(int j = 0; j <= n; j ++) {
+            for(int i = 0; i <= n; i ++) {
+                auto pos = zero3f, du = zero3f, dv = zero3f; auto texcoord = zero2f;
+                for(int r = 0; r < 4; r ++) {
+                    for(int c = 0; c < 4; c ++) {
+                        auto& p = subdiv->pos[cp[r][c]];
+                        pos += p * (w[i][c] * w[j][r]);
+                        if(smooth) { du += p * (dw[i][c] * w[j][r]); dv += p * (w[i][c] * dw[j][r]); }
+                        if(has_texcoord) texcoord += subdiv->texcoord[cp[r][c]] * (w[i][c] * w[j][r]);
+                    }
+                }
+                auto gid = (j0+j)*(grid.n+1)+(i0+i);
+                grid.pos[gid] = pos;
+                if(smooth) grid.norm[gid] = normalize(cross(du,dv));
+                if(has_texcoord) grid.texcoord[gid] = texcoord;
+            }
+        }
+        return;
+    }
+    
+    // irregular face at the target level: corners at their limit positions
+    if(n == 1) {
+        auto e = vector<int>(), d = vector<int>();
+        auto face_norm = quad_normal(subdiv->pos[f.x],subdiv->pos[f.y],subdiv->pos[f.z],subdiv->pos[f.w]);
+        for(int k = 0; k < 4; k ++) {
+            auto v = f[k];
+            auto gid = (j0+(k>=2))*(grid.n+1)+(i0+(k==1 or k==2));
+            if(_catmullclark_vertex_ring(subdiv, adj, v, e, d)) {
+                auto valence = (int)e.size();
+                auto pos = subdiv->pos[v] * float(valence*valence); auto texcoord = (has_texcoord) ? subdiv->texcoord[v] * float(valence*valence) : zero2f;
+                for(int i = 0; i < valence; i ++) {
+                    pos += subdiv->pos[e[i]] * 4 + subdiv->pos[d[i]];
+                    if(has_texcoord) texcoord += subdiv->texcoord[e[i]] * 4 + subdiv->texcoord[d[i]];
+                }
+                grid.pos[gid] = pos / float(valence*(valence+5));
+                if(has_texcoord) grid.texcoord[gid] = texcoord / float(valence*(valence+5));
+                if(smooth) {
+                    // limit tangents of Halstead et al.
+                    auto cn = cos(2*pif/valence);
+                    auto a = 1 + cn + cos(pif/valence) * sqrt(2*(9+cn));
+                    auto t1 = zero3f, t2 = zero3f;
+                    for(int i = 0; i < valence; i ++) {
+                        auto c0 = cos(2*pif*i/valence), c1 = cos(2*pif*(i+1)/valence), cm = cos(2*pif*(i-1)/valence);
+                        t1 += subdiv->pos[e[i]] * (a*c0) + subdiv->pos[d[i]] * (c0+c1);
+                        t2 += subdiv->pos[e[i]] * (a*cm) + subdiv->pos[d[i]] * (cm+c0);
+                    }
+                    auto norm = normalize(cross(t1,t2));
+                    grid.norm[gid] = (dot(norm,face_norm) < 0) ? -norm : norm;
+                }
+            } else {
+                // boundary vertices keep their refined position
+                grid.pos[gid] = subdiv->pos[v];
+                if(has_texcoord) grid.texcoord[gid] = subdiv->texcoord[v];
+                if(smooth) {
+                    auto norm = zero3f;
+                    for(auto fid : adj.vertex_faces[v]) { auto g = subdiv->quad[fid]; norm += quad_normal(subdiv->pos[g.x],subdiv->pos[g.y],subdiv->pos[g.z],subdiv->pos[g.w]); }
+                    grid.norm[gid] = normalize(norm);
+                }
+            }
+        }
+        return;
+    }
+    
+    // irregular face: refine its one-ring once and recurse on the four children (kept in the orientation of f)
+    auto local = _catmullclark_local(subdiv, adj, f);
+    auto refined = _tesselate_catmullclark_once(local);
+    auto refined_adj = _CatmullClarkAdjacency(refined);
+    auto q = refined->quad;
+    auto h = n/2;
+    _catmullclark_limit_face(refined, refined_adj, q[0], h, i0, j0, grid);
+    _catmullclark_limit_face(refined, refined_adj, _quad_rotate(q[1],q[0].y), h, i0+h, j0, grid);
+    _catmullclark_limit_face(refined, refined_adj, _quad_rotate(q[2],q[0].z), h, i0+h, j0+h, grid);
+    _catmullclark_limit_face(refined, refined_adj, _quad_rotate(q[3],q[0].w), h, i0, j0+h, grid);
+    delete refined;
+    delete local;
+}
+
+// tesselates the limit surface with a (2^level)^2 grid per control face, sharing vertices along control edges;
+// each shared vertex is written by the lowest-index face that touches it, so faces are evaluated in parallel
+Mesh* _tesselate_catmullclark_limit(CatmullClarkSubdiv* subdiv, int level, bool smooth) {
+    auto n = pow2(level);
+    auto adj = _CatmullClarkAdjacency(subdiv);
+    auto edges = EdgeHashTable(vector<vec3i>(),subdiv->quad);
+    
+    // vertex layout: control vertices, then n-1 per edge (from edge.x), then (n-1)^2 per face
+    int evo = subdiv->pos.size();
+    int fvo = evo + edges.edges.size()*(n-1);
+    auto face_edges = vector<vec4i>(subdiv->quad.size());
+    auto vertex_owner = vector<int>(subdiv->pos.size(),subdiv->quad.size());
+    auto edge_owner = vector<int>(edges.edges.size(),subdiv->quad.size());
+    for(int fid = 0; fid < subdiv->quad.size(); fid ++) {
+        auto f = subdiv->quad[fid];
+        face_edges[fid] = vec4i(edges.edge(f.x,f.y),edges.edge(f.y,f.z),edges.edge(f.w,f.z),edges.edge(f.x,f.w));
+        for(auto v : f) vertex_owner[v] = min(vertex_owner[v],fid);
+        for(auto e : face_edges[fid]) edge_owner[e] = min(edge_owner[e],fid);
+    }
+    auto edge_vertex = [&](int e, int a, int k) {
+        if(edges.edges[e].x != a) k = n-k;
+        if(k == 0) return edges.edges[e].x;
+        if(k == n) return edges.edges[e].y;
+        return evo + e*(n-1) + k-1;
+    };
+    // vertex index and whether face fid writes it, for grid sample (i,j)
+    auto grid_vertex = [&](int fid, int i, int j, bool& owned) {
+        auto f = subdiv->quad[fid];
+        auto fe = face_edges[fid];
+        int e = -1, a = 0, k = 0;
+        if(j == 0) { e = fe.x; a = f.x; k = i; }
+        else if(i == n) { e = fe.y; a = f.y; k = j; }
+        else if(j == n) { e = fe.z; a = f.w; k = i; }
+        else if(i == 0) { e = fe.w; a = f.x; k = j; }
+        if(e < 0) { owned = true; return fvo + fid*(n-1)*(n-1) + (j-1)*(n-1) + i-1; }
+        auto vid = edge_vertex(e,a,k);
+        owned = (vid < evo) ? vertex_owner[vid] == fid : edge_owner[e] == fid;
+        return vid;
+    };
+    
+    auto tesselation = new Mesh();
+    auto nverts = fvo + subdiv->quad.size()*(n-1)*(n-1);
+    tesselation->pos = subdiv->pos;
+    tesselation->pos.resize(nverts);
+    if(smooth) tesselation->norm.resize(nverts,z3f);
+    if(not subdiv->texcoord.empty()) { tesselation->texcoord = subdiv->texcoord; tesselation->texcoord.resize(nverts); }
+    tesselation->quad.resize(subdiv->quad.size()*n*n);
+    
+    parallel_for(subdiv->quad.size(), [&](int start, int end){
+        auto grid = _CatmullClarkGrid();
+        grid.n = n;
+        grid.pos.resize((n+1)*(n+1));
+        if(smooth) grid.norm.resize((n+1)*(n+1));
+        if(not subdiv->texcoord.empty()) grid.texcoord.resize((n+1)*(n+1));
+        for(int fid = start; fid < end; fid ++) {
+            _catmullclark_limit_face(subdiv, adj, subdiv->quad[fid], n, 0, 0, grid);
+            for(int j = 0; j <= n; j ++) {
+                for(int i = 0; i <= n; i ++) {
+                    bool owned; auto vid = grid_vertex(fid,i,j,owned);
+                    if(not owned) continue;
+                    auto gid = j*(n+1)+i;
+                    tesselation->pos[vid] = grid.pos[gid];
+                    if(smooth) tesselation->norm[vid] = grid.norm[gid];
+                    if(not grid.texcoord.empty()) tesselation->texcoord[vid] = grid.texcoord[gid];
+                }
+            }
+            for(int j = 0; j < n; j ++) {
+                for(int i = 0; i < n; i ++) {
+                    bool owned;
+                    tesselation->quad[fid*n*n+j*n+i] = vec4i(grid_vertex(fid,i,j,owned),grid_vertex(fid,i+1,j,owned),
+                                                             grid_vertex(fid,i+1,j+1,owned),grid_vertex(fid,i,j+1,owned));
+                }
+            }
+        }
+    });
+    
+    // highlight the control edges
+    for(int e = 0; e < edges.edges.size(); e ++) {
+        for(int k = 0; k < n; k ++) tesselation->_tesselation_lines.push_back(vec2i(edge_vertex(e,edges.edges[e].x,k),edge_vertex(e,edges.edges[e].x,k+1)));
+    }
+    
+    return tesselation;
+}
+
 Subdiv* _tesselate_subdiv_once(Subdiv* subdiv) {
     auto tesselation = new Subdiv();
     
@@ -501,6 +776,60 @@ Subdiv* _tesselate_subdiv_once(Subdiv* subdiv) {
     return tesselation;
 }
 
+size_t tesselation_bytes(Shape* shape) {
+    size_t bytes = 0;
+    if(auto pos = shape_get_pos(shape)) bytes += pos->size()*sizeof(vec3f);
+    if(auto norm = shape_get_norm(shape)) bytes += norm->size()*sizeof(vec3f);
+    if(auto texcoord = shape_get_texcoord(shape)) bytes += texcoord->size()*sizeof(vec2f);
+    if(is<TriangleMesh>(shape)) bytes += cast<TriangleMesh>(shape)->triangle.size()*sizeof(vec3i);
+    if(is<Mesh>(shape)) bytes += cast<Mesh>(shape)->triangle.size()*sizeof(vec3i) + cast<Mesh>(shape)->quad.size()*sizeof(vec4i);
+    return bytes;
+}
+
+Shape* _tesselate_displaced(DisplacedShape* displaced, int level, bool smooth) {
+    ERROR_IF_NOT(displaced->shape, "displaced shape requires a base shape");
+    auto t = timer();
+    
+    // subdivide the base shape, always with smooth frames since we displace along the normals
+    auto tesselation = tesselate_shape(displaced->shape, level, true);
+    displaced->_subdivide_time = t.elapsed();
+    ERROR_IF_NOT(is<TriangleMesh>(tesselation) or is<Mesh>(tesselation), "displacement only supported for surfaces");
+    
+    auto& pos = *shape_get_pos(tesselation);
+    auto& norm = *shape_get_norm(tesselation);
+    auto& texcoord = *shape_get_texcoord(tesselation);
+    WARNING_IF_NOT(not texcoord.empty() or not displaced->displacement, "displacement requires texture coordinates");
+    
+    // displace vertices in parallel (each vertex is independent)
+    t.start();
+    if(displaced->displacement and not texcoord.empty()) {
+        auto texture = displaced->displacement;
+        auto height = displaced->height;
+        parallel_for(pos.size(), [&](int start, int end){
+            for(int vid = start; vid < end; vid ++) {
+                auto d = mean_component(texture_lookup_bilinear(texture, texcoord[vid]));
+                pos[vid] += norm[vid] * (height * d);
+            }
+        });
+    }
+    displaced->_displace_time = t.elapsed();
+    
+    // recompute frames on the displaced surface, keeping the orientation of the base normals
+    // since parametric shapes do not guarantee a winding consistent with their frames
+    t.start();
+    if(smooth) {
+        auto base_norm = norm;
+        shape_smooth_frames(tesselation);
+        parallel_for(norm.size(), [&](int start, int end){
+            for(int vid = start; vid < end; vid ++) if(dot(norm[vid],base_norm[vid]) < 0) norm[vid] = -norm[vid];
+        });
+    }
+    else shape_clear_frames(tesselation);
+    displaced->_frames_time = t.elapsed();
+    
+    return tesselation;
+}
+
 Shape* _tesselate_recursive(const function<Shape*(Shape*)>& tesselate_once, Shape* tesselation, int level, bool smooth,
                             const function<Shape*(Shape*)>& to_mesh = function<Shape*(Shape*)>()) {
     for(int l = 0; l < level; l ++) {
@@ -543,6 +872,7 @@ Shape* tesselate_shape(Shape* shape, int level, bool smooth) {
         return _tesselate_recursive([](Shape* s){ return _tesselate_facemesh_once(cast<FaceMesh>(s));}, tesselation, level, smooth);        
     }
     else if(is<CatmullClarkSubdiv>(shape)) {
+        if(cast<CatmullClarkSubdiv>(shape)->limit) return _tesselate_catmullclark_limit(cast<CatmullClarkSubdiv>(shape), level, smooth);
         auto tesselation = new CatmullClarkSubdiv(*cast<CatmullClarkSubdiv>(shape));
         tesselation->_tesselation_lines = EdgeHashTable(vector<vec3i>(),tesselation->quad).edges;
         return _tesselate_recursive([](Shape* s){ return _tesselate_catmullclark_once(cast<CatmullClarkSubdiv>(s));}, tesselation, level, smooth,
@@ -593,33 +923,45 @@ Shape* tesselate_shape(Shape* shape, int level, bool smooth) {
     else if(is<Patch>(shape)) {
         auto patch = cast<Patch>(shape);
         auto segments = vec2i(patch->continous_stride,patch->cubic.size()/patch->continous_stride);
+        auto ur = segments.x*pow2(level+2), vr = segments.y*pow2(level+2);
+        // segment and bezier weights only depend on the grid column (u) or row (v), so compute them once per line
+        auto seg_u = vector<int>(ur+1), seg_v = vector<int>(vr+1);
+        auto wu = vector<vec4f>(ur+1), wv = vector<vec4f>(vr+1), dwu = vector<vec4f>(ur+1), dwv = vector<vec4f>(vr+1);
+        for(int i = 0; i <= ur; i ++) {
+            auto uv = vec2f(i / float(ur), 0);
+            seg_u[i] = patch_continous_segment_xy(patch, uv).x;
+            auto p = patch_continous_param(patch, uv).x;
+            wu[i] = bernstein_cubic(p); dwu[i] = bernstein_cubic_derivative(p);
+        }
+        for(int j = 0; j <= vr; j ++) {
+            auto uv = vec2f(0, j / float(vr));
+            seg_v[j] = patch_continous_segment_xy(patch, uv).y;
+            auto p = patch_continous_param(patch, uv).y;
+            wv[j] = bernstein_cubic(p); dwv[j] = bernstein_cubic_derivative(p);
+        }
         return _tesselate_shape_uniform(
-            [patch](const vec2f& uv){
-                return patch_frame(patch,patch_continous_segment(patch, uv),
-                                   patch_continous_param(patch, uv)); },
-            [patch](const vec2f& uv) -> vec2f {
-                if(patch->texcoord.empty()) return uv;
-                return interpolate_bezier_bicubic(patch->texcoord,
-                                                  patch->cubic[patch_continous_segment(patch, uv)],
-                                                  patch_continous_param(patch, uv)); },
-            segments.x*pow2(level+2), segments.y*pow2(level+2),
-            segments.x*pow2(2), segments.y*pow2(2), false, smooth);
+            [&](int i, int j){
+                return patch_frame(patch, seg_v[j]*segments.x+seg_u[i], wu[i], wv[j], dwu[i], dwv[j]); },
+            [&](int i, int j) -> vec2f {
+                if(patch->texcoord.empty()) return vec2f(i / float(ur), j / float(vr));
+                return interpolate_bezier_bicubic(patch->texcoord, patch->cubic[seg_v[j]*segments.x+seg_u[i]], wu[i], wv[j]); },
+            ur, vr, segments.x*pow2(2), segments.y*pow2(2), false, smooth);
     }
     else if(is<TesselationOverride>(shape)) return tesselate_shape(cast<TesselationOverride>(shape)->shape, level, smooth);
-    else if(is<DisplacedShape>(shape)) {
-        PUT_YOUR_CODE_HERE("DisplacedShape");
-    }
+    else if(is<DisplacedShape>(shape)) return _tesselate_displaced(cast<DisplacedShape>(shape), level, smooth);
     else if(is<Sphere>(shape)) {
         auto sphere = cast<Sphere>(shape);
-        return _tesselate_shape_uniform([sphere](const vec2f& uv){return sphere_frame(sphere,uv);},
-                                        [sphere](const vec2f& uv){return uv;},
-                                        pow2(level+2), pow2(level+2), pow2(2), pow2(2), true, smooth);
+        auto r = pow2(level+2);
+        return _tesselate_shape_uniform([sphere,r](int i, int j){return sphere_frame(sphere,vec2f(i / float(r), j / float(r)));},
+                                        [r](int i, int j){return vec2f(i / float(r), j / float(r));},
+                                        r, r, pow2(2), pow2(2), true, smooth);
     }
     else if(is<Cylinder>(shape)) {
         auto cylinder = cast<Cylinder>(shape);
-        return _tesselate_shape_uniform([cylinder](const vec2f& uv){return cylinder_frame(cylinder,uv);},
-                                        [cylinder](const vec2f& uv){return uv;},
-                                        pow2(level+2), pow2(level+2), pow2(2), pow2(2), false, smooth);
+        auto r = pow2(level+2);
+        return _tesselate_shape_uniform([cylinder,r](int i, int j){return cylinder_frame(cylinder,vec2f(i / float(r), j / float(r)));},
+                                        [r](int i, int j){return vec2f(i / float(r), j / float(r));},
+                                        r, r, pow2(2), pow2(2), false, smooth);
     }
     else if(is<Quad>(shape)) {
         auto quad = cast<Quad>(shape);
@@ -669,7 +1011,14 @@ void primitive_tesselation_init(Primitive* prim, bool override, int override_lev
 }
 
 void primitives_tesselation_init(PrimitiveGroup* group, bool override, int override_level, bool override_smooth) {
-    for(auto p : group->prims) primitive_tesselation_init(p,override,override_level,override_smooth);
+    // shapes shared by several primitives, e.g. merged by scene_deduplicate, are tesselated once
+    auto tesselated = map<Shape*,bool>();
+    for(auto p : group->prims) {
+        auto shape = (is<Surface>(p)) ? cast<Surface>(p)->shape : (is<TransformedSurface>(p)) ? cast<TransformedSurface>(p)->shape : nullptr;
+        if(shape and tesselated[shape]) continue;
+        primitive_tesselation_init(p,override,override_level,override_smooth);
+        tesselated[shape] = true;
+    }
 }
 
 void scene_tesselation_init(Scene* scene, bool override, int override_level, bool override_smooth) {
@@ -45,6 +45,8 @@ struct EdgeHashTable {
 ///@name shape tesselate interface
 ///@{
 Shape* tesselate_shape(Shape* shape, int level, bool smooth);
+/// bytes held by the vertex and element arrays of a tesselation
+size_t tesselation_bytes(Shape* shape);
 ///@}
 
 ///@name tesselation interface
@@ -1,3 +1,17 @@
 #include "texture.h"
 
 ///@file igl/texture.cpp Textures. @ingroup igl
+
+vec3f texture_lookup_bilinear(Texture* texture, const vec2f& texcoord) {
+    auto& img = texture->image;
+    if(img.width() == 0 or img.height() == 0) return zero3f;
+    // tile the texture and lookup at pixel centers
+    auto s = (texcoord.x - floor(texcoord.x)) * img.width() - 0.5f;
+    auto t = (texcoord.y - floor(texcoord.y)) * img.height() - 0.5f;
+    auto i0 = (int)floor(s), j0 = (int)floor(t);
+    auto uv = vec2f(s - i0, t - j0);
+    auto i1 = i0+1, j1 = j0+1;
+    i0 = (i0 + img.width()) % img.width(); i1 = i1 % img.width();
+    j0 = (j0 + img.height()) % img.height(); j1 = j1 % img.height();
+    return interpolate_bilinear(img.at(i0,j0), img.at(i1,j0), img.at(i1,j1), img.at(i0,j1), uv);
+}
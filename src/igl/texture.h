@@ -21,6 +21,10 @@ struct Texture : Node {
     unsigned int _shade_glid = 0; ///< opengl shading texture id
 };
 
+///@name texture lookup
+///@{
+vec3f texture_lookup_bilinear(Texture* texture, const vec2f& texcoord);
+///@}
 
 ///@}
 
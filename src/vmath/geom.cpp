@@ -2,6 +2,32 @@
 
 ///@file vmath/geom.cpp Geometric math. @ingroup vmath
 
+// Sutherland-Hodgman clipping of the triangle against the six box planes
+range3f triangle_clipped_bounds(const vec3f& v0, const vec3f& v1, const vec3f& v2, const range3f& bbox) {
+    // a triangle clipped by six planes has at most nine vertices
+    vec3f poly[9] = { v0, v1, v2 }, clipped[9];
+    int npoly = 3;
+    for(int axis = 0; axis < 3; axis ++) {
+        for(int side = 0; side < 2; side ++) {
+            int nclipped = 0;
+            for(int i = 0; i < npoly; i ++) {
+                auto& a = poly[i]; auto& b = poly[(i+1)%npoly];
+                auto da = (side == 0) ? a[axis] - bbox.min[axis] : bbox.max[axis] - a[axis];
+                auto db = (side == 0) ? b[axis] - bbox.min[axis] : bbox.max[axis] - b[axis];
+                if(da >= 0) clipped[nclipped++] = a;
+                if((da >= 0) != (db >= 0)) clipped[nclipped++] = a + (b-a) * (da / (da-db));
+            }
+            for(int i = 0; i < nclipped; i ++) poly[i] = clipped[i];
+            npoly = nclipped;
+            if(npoly == 0) return range3f();
+        }
+    }
+    auto ret = range3f();
+    for(int i = 0; i < npoly; i ++) ret = runion(ret, poly[i]);
+    // clamp numerical errors of the intersection points
+    return rintersect(ret, bbox);
+}
+
 // from pbrt
 bool intersect_bbox(const ray3f& ray, const range3f& bbox, float& t0, float& t1) {
     t0 = ray.tmin; t1 = ray.tmax;
@@ -38,6 +64,21 @@ bool intersect_triangle(const ray3f& ray,
     return true;
 }
 
+// quad split along v0-v2 into (v0,v1,v2) and (v0,v2,v3); half is the triangle hit, ba/bb its baricentric coordinates
+bool intersect_quad_triangles(const ray3f& ray,
+                              const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& v3,
+                              float& t, float& ba, float& bb, int& half) {
+    if(intersect_triangle(ray, v0, v1, v2, t, ba, bb)) {
+        half = 0;
+        auto sray = ray; sray.tmax = t;
+        float st, sba, sbb;
+        if(intersect_triangle(sray, v0, v2, v3, st, sba, sbb) and st < t) { t = st; ba = sba; bb = sbb; half = 1; }
+        return true;
+    }
+    if(intersect_triangle(ray, v0, v2, v3, t, ba, bb)) { half = 1; return true; }
+    return false;
+}
+
 bool intersect_sphere(const ray3f& ray, const vec3f& o, float r, float& t) {
     auto a = lengthSqr(ray.d);
     auto b = 2*dot(ray.d,ray.e-o);
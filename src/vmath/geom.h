@@ -31,6 +31,8 @@ inline range3f sphere_bounds(const vec3f& pos, float r) { return range3f(pos-vec
 inline range3f cylinder_bounds(float r, float h) { return range3f(vec3f(-r,-r,0),vec3f(r,r,h)); }
 inline range3f quad_bounds(float w, float h) { return range3f(vec3f(-w/2,-h/2,0),vec3f(w/2,h/2,0)); }
 inline range3f quad_bounds(const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& v3) { return range_from_values(v0,v1,v2,v3); }
+range3f triangle_clipped_bounds(const vec3f& v0, const vec3f& v1, const vec3f& v2, const range3f& bbox);
+inline range3f quad_clipped_bounds(const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& v3, const range3f& bbox) { return runion(triangle_clipped_bounds(v0,v1,v2,bbox),triangle_clipped_bounds(v0,v2,v3,bbox)); }
 ///@}
 
 ///@name normal
@@ -53,6 +55,7 @@ inline float sphere_volume(float r) { return 4*pi/3*r*r*r; }
 ///@{
 bool intersect_bbox(const ray3f& ray, const range3f& bbox, float& t0, float& t1);
 bool intersect_triangle(const ray3f& ray, const vec3f& v0, const vec3f& v1, const vec3f& v2, float& t, float& ba, float& bb);
+bool intersect_quad_triangles(const ray3f& ray, const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& v3, float& t, float& ba, float& bb, int& half);
 bool intersect_sphere(const ray3f& ray, const vec3f& o, float r, float& t);
 bool intersect_quad(const ray3f& ray, float w, float h, float& t, float& ba, float& bb);
 bool intersect_cylinder(const ray3f& ray, float r, float h, float& t);
@@ -64,6 +67,7 @@ bool intersect_line_approximate(const ray3f& ray, const vec3f& v0, const vec3f&
 ///@{
 inline bool intersect_bbox(const ray3f& ray, const range3f& bbox) { float t0, t1; return intersect_bbox(ray,bbox,t0,t1); }
 inline bool intersect_triangle(const ray3f& ray, const vec3f& v0, const vec3f& v1, const vec3f& v2) { float t, ba, bb; return intersect_triangle(ray, v0, v1, v2, t, ba, bb); }
+inline bool intersect_quad_triangles(const ray3f& ray, const vec3f& v0, const vec3f& v1, const vec3f& v2, const vec3f& v3) { return intersect_triangle(ray, v0, v1, v2) or intersect_triangle(ray, v0, v2, v3); }
 inline bool intersect_sphere(const ray3f& ray, const vec3f& o, float r) { float t; return intersect_sphere(ray, o, r, t); }
 inline bool intersect_quad(const ray3f& ray, float w, float h) { float t, ba, bb; return intersect_quad(ray,w,h,t,ba,bb); }
 inline bool intersect_cylinder(const ray3f& ray, float r, float h) { float t; return intersect_cylinder(ray,r,h,t); }
@@ -15,6 +15,14 @@
 ///@{
 float bernstein(float u, int i, int degree);
 float bernstein_derivative(float u, int i, int degree);
+inline vec4f bernstein_cubic(float u) { return vec4f(bernstein(u,0,3),bernstein(u,1,3),bernstein(u,2,3),bernstein(u,3,3)); }
+inline vec4f bernstein_cubic_derivative(float u) { return vec4f(bernstein_derivative(u,0,3),bernstein_derivative(u,1,3),bernstein_derivative(u,2,3),bernstein_derivative(u,3,3)); }
+///@}
+
+///@name uniform cubic B-spline basis (the four weights of a span at u)
+///@{
+inline vec4f bspline_cubic(float u) { return vec4f((1-u)*(1-u)*(1-u),3*u*u*u-6*u*u+4,-3*u*u*u+3*u*u+3*u+1,u*u*u) / 6.0f; }
+inline vec4f bspline_cubic_derivative(float u) { return vec4f(-(1-u)*(1-u),3*u*u-4*u,-3*u*u+2*u+1,u*u) / 2.0f; }
 ///@}
 
 ///@name linear interpolation
@@ -38,23 +46,16 @@ template<typename T> inline T interpolate_bezier_cubic_derivative(const T& v0, c
 template<typename T> inline T interpolate_bezier_cubic_derivative(const std::vector<T>& v, const vec4i& i, float t) { return interpolate_bezier_cubic_derivative(v[i.x], v[i.y], v[i.z], v[i.w], t); }
 ///@}
 
-///@name bicubic bezier interpolation
+///@name bicubic bezier interpolation (the weights versions take precomputed bernstein_cubic or bernstein_cubic_derivative values along u and v)
 ///@{
-template<typename T> inline T interpolate_bezier_bicubic(const std::vector<T>& v, const mat4i& idx, const vec2f& uv) {
-    auto ret = T();
-    for(int i = 0; i < 4; i ++) for(int j = 0; j < 4; j ++) ret += v[idx[i][j]] * bernstein(uv.x, i, 3) * bernstein(uv.y, j, 3);
-    return ret;
-}
-template<typename T> inline T interpolate_bezier_bicubic_derivativex(const std::vector<T>& v, const mat4i& idx, const vec2f& uv) {
-    auto ret = T();
-    for(int i = 0; i < 4; i ++) for(int j = 0; j < 4; j ++) ret += v[idx[i][j]] * bernstein_derivative(uv.x, i, 3) * bernstein(uv.y, j, 3);
-    return ret;
-}
-template<typename T> inline T interpolate_bezier_bicubic_derivativey(const std::vector<T>& v, const mat4i& idx, const vec2f& uv) {
+template<typename T> inline T interpolate_bezier_bicubic(const std::vector<T>& v, const mat4i& idx, const vec4f& wu, const vec4f& wv) {
     auto ret = T();
-    for(int i = 0; i < 4; i ++) for(int j = 0; j < 4; j ++) ret += v[idx[i][j]] * bernstein(uv.x, i, 3) * bernstein_derivative(uv.y, j, 3);
+    for(int i = 0; i < 4; i ++) for(int j = 0; j < 4; j ++) ret += v[idx[i][j]] * wu[i] * wv[j];
     return ret;
 }
+template<typename T> inline T interpolate_bezier_bicubic(const std::vector<T>& v, const mat4i& idx, const vec2f& uv) { return interpolate_bezier_bicubic(v, idx, bernstein_cubic(uv.x), bernstein_cubic(uv.y)); }
+template<typename T> inline T interpolate_bezier_bicubic_derivativex(const std::vector<T>& v, const mat4i& idx, const vec2f& uv) { return interpolate_bezier_bicubic(v, idx, bernstein_cubic_derivative(uv.x), bernstein_cubic(uv.y)); }
+template<typename T> inline T interpolate_bezier_bicubic_derivativey(const std::vector<T>& v, const mat4i& idx, const vec2f& uv) { return interpolate_bezier_bicubic(v, idx, bernstein_cubic(uv.x), bernstein_cubic_derivative(uv.y)); }
 ///@}
 
 ///@name baricentric triangle interpolation
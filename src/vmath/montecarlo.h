@@ -208,11 +208,11 @@ inline DistrubutionSample1D sample_distribution1d(Distribution1D* dist, float u)
     auto cdf = &dist->cdf[0];
     auto ptr = std::upper_bound(cdf, cdf+dist->cdf.size(), u);
     ret.index = max(0, int(ptr-cdf-1));
-    ERROR_IF_NOT(ret.index < dist->values.size(), "incorrect cdf sampling");
-    ERROR_IF_NOT(u >= cdf[ret.index] && u < cdf[ret.index+1], "incorrect cdf sampling");
+    DEBUG_ERROR_IF_NOT(ret.index < dist->values.size(), "incorrect cdf sampling");
+    DEBUG_ERROR_IF_NOT(u >= cdf[ret.index] && u < cdf[ret.index+1], "incorrect cdf sampling");
     
     auto du = (u - cdf[ret.index]) / (cdf[ret.index+1] - cdf[ret.index]);
-    ERROR_IF_NOT(not std::isnan(du), "problem with du");
+    DEBUG_ERROR_IF_NOT(not std::isnan(du), "problem with du");
     
     ret.pdf = dist->values[ret.index] / dist->integral;
     ret.value =  (ret.index + du) / dist->values.size();
@@ -42,6 +42,13 @@ struct Rng {
     int next_int(const range1i& r) { return next_int(r.min,r.max); }
 };
 
+/// Seed from a pair of integers (e.g. a pixel and its sample count), hashed since the engine's first outputs
+/// follow its seed linearly, so that neighbouring pairs get unrelated sequences
+inline unsigned int rng_seed_hash(unsigned int a, unsigned int b) {
+    auto mix = [](unsigned int h) { h ^= h >> 16; h *= 0x85ebca6bu; h ^= h >> 13; h *= 0xc2b2ae35u; h ^= h >> 16; return h; };
+    return mix(mix(a) + b);
+}
+
 /// Create and seed nrngs generators
 inline std::vector<Rng> rng_generate_seeded(int nrngs) {
     std::seed_seq sseq{0,1,2,3,4,5,6,7,8,9};
@@ -111,6 +111,8 @@ template<typename T> inline vec2<T> center(const range2<T>& a) { return (a.max+a
 template<typename T> inline range2<T> runion(const range2<T>& a, const vec2<T>& b) { if(not isvalid(a)) return range2<T>(b,b); return range2<T>(min(a.min,b),max(a.max,b)); }
 template<typename T> inline range2<T> runion(const range2<T>& a, const range2<T>& b) { if(not isvalid(a)) return b; if(not isvalid(b)) return a; return range2<T>(min(a.min,b.min),max(a.max,b.max)); }
 
+template<typename T> inline range2<T> rintersect(const range2<T>& a, const range2<T>& b) { if(not isvalid(a) or not isvalid(b)) return range2<T>(); auto ret = range2<T>(max(a.min,b.min),min(a.max,b.max)); return (isvalid(ret)) ? ret : range2<T>(); }
+
 template<typename T> inline range2<T> rscale(const range2<T>& a, const T& b) { return range2<T>(center(a)-size(a)*b/2,center(a)+size(a)*b/2); }
 ///@}
 
@@ -162,6 +164,8 @@ template<typename T> inline vec3<T> center(const range3<T>& a) { return (a.max+a
 
 template<typename T> inline range3<T> runion(const range3<T>& a, const vec3<T>& b) { if(not isvalid(a)) return range3<T>(b,b); return range3<T>(min(a.min,b),max(a.max,b)); }
 template<typename T> inline range3<T> runion(const range3<T>& a, const range3<T>& b) { if(not isvalid(a)) return b; if(not isvalid(b)) return a; return range3<T>(min(a.min,b.min),max(a.max,b.max)); }
+template<typename T> inline range3<T> rintersect(const range3<T>& a, const range3<T>& b) { if(not isvalid(a) or not isvalid(b)) return range3<T>(); auto ret = range3<T>(max(a.min,b.min),min(a.max,b.max)); return (isvalid(ret)) ? ret : range3<T>(); }
+template<typename T> inline T area(const range3<T>& a) { if(not isvalid(a)) return 0; auto d = size(a); return 2*(d.x*d.y+d.y*d.z+d.z*d.x); }
 
 template<typename T> inline range3<T> rscale(const range3<T>& a, const T& b) { return range3<T>(center(a)-size(a)*b/2,center(a)+size(a)*b/2); }
 